@@ -0,0 +1,75 @@
+#include "../include/range_kernel.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kCandidates = 1 << 16;
+const int kAttackers = 512;
+const int kDistance = 20;
+
+template <typename F>
+double measure(F&& body, uint64_t& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    checksum = body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}
+
+int main() {
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<> coord(0, 999);
+
+    std::vector<int> xs(kCandidates), ys(kCandidates);
+    for (int k = 0; k < kCandidates; ++k) {
+        xs[k] = coord(gen);
+        ys[k] = coord(gen);
+    }
+    std::vector<int> ax(kAttackers), ay(kAttackers);
+    for (int a = 0; a < kAttackers; ++a) {
+        ax[a] = coord(gen);
+        ay[a] = coord(gen);
+    }
+
+    uint64_t reference = 0;
+    double hypotMs = measure([&]() {
+        uint64_t hits = 0;
+        for (int a = 0; a < kAttackers; ++a) {
+            for (int k = 0; k < kCandidates; ++k) {
+                if (std::hypot(ax[a] - xs[k], ay[a] - ys[k]) <= kDistance) ++hits;
+            }
+        }
+        return hits;
+    }, reference);
+
+    std::cout << "pairs: " << static_cast<long long>(kAttackers) * kCandidates << ", hits: " << reference << "\n";
+    std::cout << "hypot:  " << hypotMs << " ms\n";
+
+    const RangeKernelIsa paths[] = {RangeKernelIsa::Scalar, RangeKernelIsa::SSE2, RangeKernelIsa::AVX2};
+    for (RangeKernelIsa isa : paths) {
+        if (!isRangeKernelSupported(isa)) continue;
+
+        uint64_t hits = 0;
+        double ms = measure([&]() {
+            uint64_t total = 0;
+            for (int a = 0; a < kAttackers; ++a) {
+                for (int k = 0; k < kCandidates; k += 64) {
+                    uint64_t mask = rangeMaskWith(isa, ax[a], ay[a], &xs[k], &ys[k], 64, kDistance);
+                    total += static_cast<uint64_t>(__builtin_popcountll(mask));
+                }
+            }
+            return total;
+        }, hits);
+
+        std::cout << rangeKernelName(isa) << ": " << ms << " ms (x" << hypotMs / ms << ")"
+                  << (hits == reference ? "" : "  MISMATCH") << "\n";
+    }
+
+    return 0;
+}
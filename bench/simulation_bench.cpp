@@ -0,0 +1,207 @@
+#include "../include/rng.hpp"
+#include "../include/scenario.hpp"
+#include "../include/snapshot.hpp"
+#include "../include/spatial_grid.hpp"
+#include "../include/thread_pool.hpp"
+#include "../include/world.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint64_t kSeed = 12345;
+
+// Keeps the density of the interactive game (50 NPCs on 100x100) so contact
+// counts per NPC stay comparable across sizes.
+int mapSideFor(size_t count) {
+    return std::max(100, static_cast<int>(std::sqrt(static_cast<double>(count) / 0.005)));
+}
+
+void populate(World& world, size_t count) {
+    world.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        CounterRng rng(kSeed, i, 0, RngStream::Spawn);
+        int x = rng.uniform(0, world.getMapSizeX() - 1);
+        int y = rng.uniform(0, world.getMapSizeY() - 1);
+        NpcType type = static_cast<NpcType>(rng.uniform(0, static_cast<int>(kSpeciesCount) - 1));
+        world.add(type, typeName(type) + std::to_string(i), x, y);
+    }
+}
+
+// Bears paired with ducks at the same spot: every pair is a real fight.
+void populateFightPairs(World& world, size_t count) {
+    world.reserve(count);
+    for (size_t i = 0; i + 1 < count; i += 2) {
+        int x = static_cast<int>(i % static_cast<size_t>(world.getMapSizeX()));
+        int y = static_cast<int>(i / static_cast<size_t>(world.getMapSizeX()));
+        world.add(NpcType::Bear, "Bear" + std::to_string(i), x, y);
+        world.add(NpcType::Duck, "Duck" + std::to_string(i + 1), x, y);
+    }
+}
+
+void sizes(benchmark::internal::Benchmark* b) {
+    b->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+}
+
+void BM_MoveRandomly(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    World world(mapSideFor(count), mapSideFor(count), kSeed);
+    populate(world, count);
+    for (auto _ : state) {
+        world.beginTick();
+        world.moveAll();
+        benchmark::DoNotOptimize(world.xData());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_MoveRandomly)->Apply(sizes);
+
+void BM_RangeCheckPairs(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    World world(mapSideFor(count), mapSideFor(count), kSeed);
+    populate(world, count);
+    for (auto _ : state) {
+        size_t hits = 0;
+        for (size_t i = 1; i < count; ++i) {
+            hits += world.isInRangeForKill(i - 1, i);
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count - 1));
+}
+BENCHMARK(BM_RangeCheckPairs)->Apply(sizes);
+
+void BM_FindContacts(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    World world(mapSideFor(count), mapSideFor(count), kSeed);
+    populate(world, count);
+    SpatialGrid grid;
+    size_t contacts = 0;
+    for (auto _ : state) {
+        contacts = grid.findContacts(world).size();
+        benchmark::DoNotOptimize(contacts);
+    }
+    state.counters["contacts"] = static_cast<double>(contacts);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_FindContacts)->Apply(sizes);
+
+void BM_Fight(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    World world(mapSideFor(count), mapSideFor(count), kSeed);
+    populateFightPairs(world, count);
+    // Fights kill NPCs, so every iteration starts again from a copy of the
+    // initial columns.
+    const std::vector<int> xs(world.xData(), world.xData() + world.size());
+    const std::vector<int> ys(world.yData(), world.yData() + world.size());
+    const std::vector<NpcType> types(world.typeData(), world.typeData() + world.size());
+    const std::vector<uint8_t> allAlive(world.size(), 1);
+    std::vector<std::string> names;
+    for (size_t i = 0; i < world.size(); ++i) names.emplace_back(world.getName(i));
+    for (auto _ : state) {
+        state.PauseTiming();
+        world.assign(world.getMapSizeX(), world.getMapSizeY(), xs.size(), xs.data(), ys.data(),
+                     allAlive.data(), types.data(), names);
+        world.beginTick();
+        state.ResumeTiming();
+
+        size_t won = 0;
+        for (size_t i = 0; i + 1 < world.size(); i += 2) {
+            won += world.fight(i, i + 1) == FightResult::Won;
+        }
+        benchmark::DoNotOptimize(won);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(world.size() / 2));
+}
+BENCHMARK(BM_Fight)->Apply(sizes);
+
+void BM_SaveSnapshot(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    World world(mapSideFor(count), mapSideFor(count), kSeed);
+    populate(world, count);
+    const std::string path = "bench_snapshot.bin";
+    for (auto _ : state) {
+        saveSnapshot(world, path);
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_SaveSnapshot)->Apply(sizes);
+
+void BM_LoadSnapshot(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    const std::string path = "bench_snapshot.bin";
+    {
+        World world(mapSideFor(count), mapSideFor(count), kSeed);
+        populate(world, count);
+        saveSnapshot(world, path);
+    }
+    for (auto _ : state) {
+        World loaded(1, 1);
+        loadSnapshot(loaded, path);
+        benchmark::DoNotOptimize(loaded.size());
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_LoadSnapshot)->Apply(sizes);
+
+void writeTextWorld(const std::string& path, size_t count) {
+    World world(mapSideFor(count), mapSideFor(count), kSeed);
+    populate(world, count);
+    std::ofstream os(path);
+    exportText(world, os);
+}
+
+void BM_ImportText(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    const std::string path = "bench_world.txt";
+    writeTextWorld(path, count);
+    for (auto _ : state) {
+        World loaded(1, 1);
+        std::ifstream is(path);
+        importText(loaded, is);
+        benchmark::DoNotOptimize(loaded.size());
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_ImportText)->Apply(sizes);
+
+void BM_LoadTextFile(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    const std::string path = "bench_world.txt";
+    writeTextWorld(path, count);
+    ThreadPool pool;
+    for (auto _ : state) {
+        World loaded(1, 1);
+        loadTextFile(loaded, path, pool);
+        benchmark::DoNotOptimize(loaded.size());
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_LoadTextFile)->Apply(sizes);
+
+void BM_GenerateScenario(benchmark::State& state) {
+    ScenarioSpec spec;
+    spec.count = static_cast<size_t>(state.range(0));
+    spec.seed = 7;
+    ThreadPool pool;
+    for (auto _ : state) {
+        World world(1000, 1000);
+        generateScenario(world, spec, pool);
+        benchmark::DoNotOptimize(world.size());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(spec.count));
+}
+BENCHMARK(BM_GenerateScenario)->Apply(sizes);
+
+}
+
+BENCHMARK_MAIN();
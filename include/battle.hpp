@@ -0,0 +1,110 @@
+#pragma once
+
+#include "fight_log.hpp"
+#include "thread_pool.hpp"
+#include "world.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class ReplayRecorder;
+
+// Handles rather than indices: a task can sit in the queue or the deferred
+// set while its NPCs die and their slots are reused.
+struct BattleTask {
+    NpcHandle attacker;
+    NpcHandle target;
+};
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov's
+// sequence-numbered ring). Capacity is rounded up to a power of two.
+class BattleQueue {
+public:
+    explicit BattleQueue(size_t capacity);
+
+    bool tryPush(const BattleTask& task);
+    bool tryPop(BattleTask& task);
+
+    size_t depth() const;
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        BattleTask task;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+};
+
+// Drains a BattleQueue with several workers on the pool. A worker claims
+// both combatants before fighting; when either is already claimed the task
+// goes back on the queue, so an NPC is never in two fights at once.
+class BattleWorkers {
+public:
+    BattleWorkers(World& world, BattleQueue& queue, size_t workers);
+
+    // Runs until the queue is empty.
+    void drain(ThreadPool& pool);
+
+    // Every resolved fight is appended to `log` from the fighting thread.
+    void setFightLog(AsyncFightLog* log) { fightLog = log; }
+    // Every fight is also appended to `recorder`, in resolution order.
+    void setRecorder(ReplayRecorder* value) { recorder = value; }
+
+    size_t getWorkerCount() const { return workers; }
+    uint64_t getFights() const { return fights.load(std::memory_order_relaxed); }
+    uint64_t getKills() const { return kills.load(std::memory_order_relaxed); }
+    uint64_t getClaimFailures() const { return claimFailures.load(std::memory_order_relaxed); }
+    uint64_t getStale() const { return stale.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    World& world;
+    BattleQueue& queue;
+    size_t workers;
+    AsyncFightLog* fightLog = nullptr;
+    ReplayRecorder* recorder = nullptr;
+    std::atomic<uint64_t> fights{0};
+    std::atomic<uint64_t> kills{0};
+    std::atomic<uint64_t> claimFailures{0};
+    std::atomic<uint64_t> stale{0};
+};
+
+enum class Backpressure { Drop, Coalesce };
+
+// Turns one tick's contacts into battle tasks. Contacts are deduplicated by
+// handle pair, pairs that can never fight (dead NPCs, Duck attackers, ...) are
+// filtered out, and when the queue is full the rest are either dropped or
+// coalesced into a bounded deferred set that is resubmitted next tick.
+class ContactCoalescer {
+public:
+    ContactCoalescer(BattleQueue& queue, Backpressure policy);
+
+    void submit(const World& world, const std::vector<std::pair<size_t, size_t>>& contacts);
+
+    size_t getDeferred() const { return deferred.size(); }
+    uint64_t getQueued() const { return queued; }
+    uint64_t getDuplicates() const { return duplicates; }
+    uint64_t getImpossible() const { return impossible; }
+    uint64_t getCoalesced() const { return coalesced; }
+    uint64_t getDropped() const { return dropped; }
+
+private:
+    BattleQueue& queue;
+    Backpressure policy;
+    std::vector<BattleTask> deferred;
+    std::vector<BattleTask> scratch;
+    uint64_t queued = 0;
+    uint64_t duplicates = 0;
+    uint64_t impossible = 0;
+    uint64_t coalesced = 0;
+    uint64_t dropped = 0;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "world.hpp"
+#include "world_frame.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Incremental checkpoint, version 1: a base snapshot at "<path>" (the
+// snapshot format) plus an append-only delta log at "<path>.delta":
+//
+//   char magic[8]
+//   per checkpoint: DeltaHeader, DeltaEntry[count]
+//
+// Each delta lists only the NPCs whose position, alive flag or species
+// changed since the previous checkpoint. The checksum covers the entries,
+// so a delta cut short by a crash is detected and ignored on load.
+struct DeltaHeader {
+    uint64_t tick;
+    uint64_t count;
+    uint64_t checksum;
+};
+
+struct DeltaEntry {
+    uint32_t index;
+    int32_t x;
+    int32_t y;
+    uint8_t alive;
+    uint8_t type;
+    uint8_t reserved[2];
+};
+
+static_assert(sizeof(DeltaHeader) == 24, "DeltaHeader layout is part of the file format");
+static_assert(sizeof(DeltaEntry) == 16, "DeltaEntry layout is part of the file format");
+
+// Writes checkpoints on a background thread. The simulation hands over an
+// immutable WorldFrame at a tick boundary, which costs a pointer copy; the
+// writer diffs it against the last frame it wrote and appends the delta.
+// If frames arrive faster than they are written, only the newest pending
+// one is kept: a delta is always against the last frame on disk, so
+// skipping one loses nothing.
+//
+// NPCs are matched by slot and generation. A delta cannot carry a new
+// NPC's name, so when a frame has slots added or reused since the last
+// frame written, the writer appends nothing more and needsBase() turns
+// true; the owner then calls rebase() on the simulation thread.
+class Checkpointer {
+public:
+    Checkpointer() = default;
+    ~Checkpointer() { close(); }
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // Writes the base snapshot of `world` and starts the writer. Throws
+    // std::runtime_error on I/O errors.
+    void open(const std::string& path, const World& world);
+    // Writes whatever is pending, then stops the writer.
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    void submit(std::shared_ptr<const WorldFrame> frame);
+    // Blocks until every submitted frame has been written or skipped.
+    void flush();
+
+    bool needsBase() const { return baseNeeded.load(std::memory_order_relaxed); }
+    // Starts over with a fresh base snapshot of `world` at the same path.
+    // An I/O error closes the checkpointer and sets hasFailed().
+    void rebase(const World& world);
+    // A write to the log or a rebase failed; checkpoints after the last
+    // complete delta are lost.
+    bool hasFailed() const { return failed.load(std::memory_order_relaxed); }
+
+    uint64_t getWritten() const { return written.load(std::memory_order_relaxed); }
+    uint64_t getSkipped() const { return skipped.load(std::memory_order_relaxed); }
+    uint64_t getEntries() const { return entries.load(std::memory_order_relaxed); }
+
+private:
+    void writerLoop();
+    // False when nothing was appended: the frame needs a new base, or the
+    // write failed.
+    bool writeDelta(const WorldFrame& frame);
+
+    std::string path;
+    std::FILE* file = nullptr;
+    std::shared_ptr<const WorldFrame> last;
+    std::shared_ptr<const WorldFrame> pending;
+    std::vector<DeltaEntry> scratch;
+    std::thread writer;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool busy = false;
+    bool stopping = false;
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> entries{0};
+    std::atomic<bool> baseNeeded{false};
+    std::atomic<bool> failed{false};
+};
+
+// Rebuilds `world` from the base snapshot and every complete delta and
+// returns the tick of the last delta applied (the base's tick if none).
+// Throws std::runtime_error when the base or the log is unreadable.
+uint64_t loadCheckpoint(World& world, const std::string& path);
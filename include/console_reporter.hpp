@@ -0,0 +1,49 @@
+#pragma once
+
+#include "event_bus.hpp"
+#include "species.hpp"
+#include "world.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Console output for a running simulation, fed by the EventBus. Producers
+// only append events to the bus's per-thread buffers; the reporter gets
+// one batch per tick on the bus thread and prints it with a single
+// buffered write:
+//
+//   [tick 12] 3 kills: Bear>Duck 2, Desman>Bear 1 | alive: Bear 10, Duck 4, Desman 7
+//
+// Verbose mode adds a "[BATTLE] <killer> killed <victim>" line per kill,
+// still in the same write. With a top-N, the tick's busiest killers are
+// listed too. Ticks without kills print nothing.
+class ConsoleReporter {
+public:
+    // Alive counts start from `world`, so construct it before the
+    // simulation runs; Kill and Spawn events keep them current.
+    ConsoleReporter(const World& world, std::ostream& os, std::mutex& outMutex);
+
+    static constexpr EventMask kFilter = eventBit(EventType::Kill) | eventBit(EventType::Spawn);
+
+    void setVerbose(bool value) { verbose = value; }
+    void setTopN(size_t value) { topN = value; }
+
+    // Bus handler: formats the tick and writes it out.
+    void report(uint64_t tick, const std::vector<WorldEvent>& events);
+    // Appends the text for one tick to `out` and updates the alive counts.
+    void format(uint64_t tick, const std::vector<WorldEvent>& events, std::string& out);
+
+    uint64_t getAlive(NpcType type) const { return alive[static_cast<size_t>(type)]; }
+
+private:
+    std::ostream& os;
+    std::mutex& outMutex;
+    bool verbose = false;
+    size_t topN = 0;
+    std::array<uint64_t, kSpeciesCount> alive{};
+    std::string buffer;
+};
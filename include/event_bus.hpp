@@ -0,0 +1,124 @@
+#pragma once
+
+#include "npc_system.hpp"
+#include "species.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+enum class EventType : uint8_t { Fight, Kill, Move, Spawn };
+
+constexpr size_t kEventTypeCount = 4;
+
+using EventMask = uint32_t;
+
+constexpr EventMask eventBit(EventType type) {
+    return EventMask{1} << static_cast<size_t>(type);
+}
+
+constexpr EventMask kAllEvents = (EventMask{1} << kEventTypeCount) - 1;
+
+// One thing that happened in the World. Fight and Kill name the attacker as
+// `npc` and the defender as `other`; Move and Spawn only fill the `npc`
+// fields, with the NPC's new position. Names point into the World's
+// NameTable, which never moves them.
+struct WorldEvent {
+    uint64_t tick = 0;
+    EventType type = EventType::Fight;
+    NpcType npcType = NpcType::Bear;
+    NpcType otherType = NpcType::Bear;
+    bool win = false;
+    uint32_t npc = 0;
+    uint32_t other = 0;
+    int32_t x = 0, y = 0;
+    int32_t otherX = 0, otherY = 0;
+    std::string_view npcName, otherName;
+};
+
+// World-level event bus. Producers publish() from any thread into sharded
+// buffers; the simulation calls flush() once per tick, which hands that
+// tick's events to every interested subscriber as one batch. Each
+// subscriber runs on its own thread with its own queue, so a slow one (a
+// console, a file) never holds up fights or the other subscribers.
+//
+// Subscribe before the simulation starts publishing. Nothing is recorded
+// for event types no subscriber asked for.
+class EventBus {
+public:
+    // Called with the subscriber's events from one tick, in publication
+    // order per producer thread. Never called with an empty batch.
+    using Handler = std::function<void(uint64_t tick, const std::vector<WorldEvent>& events)>;
+
+    EventBus() = default;
+    ~EventBus();
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    void subscribe(EventMask filter, Handler handler);
+    bool wants(EventType type) const { return (wanted.load(std::memory_order_relaxed) & eventBit(type)) != 0; }
+
+    void publish(const WorldEvent& event);
+    void flush(uint64_t tick);
+    // Blocks until every flushed batch has been handled.
+    void drain();
+    // Delivers what was flushed, then joins the subscriber threads.
+    void stop();
+
+    uint64_t getPublished() const { return published.load(std::memory_order_relaxed); }
+    uint64_t getBatches() const { return batches; }
+
+private:
+    using Batch = std::shared_ptr<const std::vector<WorldEvent>>;
+
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::vector<WorldEvent> events;
+    };
+
+    struct Subscriber {
+        EventMask filter;
+        Handler handler;
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::deque<std::pair<uint64_t, Batch>> queue;
+        bool busy = false;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    static constexpr size_t kShards = 16;
+
+    Shard& localShard();
+    static void run(Subscriber& subscriber);
+
+    std::array<Shard, kShards> shards;
+    std::vector<std::unique_ptr<Subscriber>> subscribers;
+    std::atomic<EventMask> wanted{0};
+    std::atomic<uint64_t> published{0};
+    uint64_t batches = 0;
+};
+
+// Feeds Fight events to an IFightObserver as freshly built NPC objects, so
+// existing observers work unchanged on a bus subscriber thread.
+class FightObserverAdapter {
+public:
+    explicit FightObserverAdapter(std::shared_ptr<IFightObserver> observer) : observer(std::move(observer)) {}
+
+    static constexpr EventMask kFilter = eventBit(EventType::Fight);
+
+    void operator()(uint64_t tick, const std::vector<WorldEvent>& events) const;
+
+private:
+    std::shared_ptr<IFightObserver> observer;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "world.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Fixed-size binary fight event. The file is a small header, the NPC name
+// table with each slot's generation at open(), then a flat array of these
+// records. Records carry the slot generations at fight time, so a fight
+// involving an NPC that took a recycled slot later is told apart from one
+// involving the slot's logged occupant.
+struct FightRecord {
+    uint64_t tick;
+    uint32_t attacker;
+    uint32_t defender;
+    uint32_t attackerGeneration;
+    uint32_t defenderGeneration;
+    int32_t attackerX, attackerY;
+    int32_t defenderX, defenderY;
+    uint8_t attackerType;
+    uint8_t defenderType;
+    uint8_t win;
+    uint8_t reserved[5];
+};
+
+static_assert(sizeof(FightRecord) == 48, "FightRecord layout is part of the file format");
+
+// Fighting threads append records to their own ring buffer; a background
+// writer drains all rings and writes them to disk in batches, so fight
+// throughput does not depend on disk latency.
+class AsyncFightLog {
+public:
+    AsyncFightLog();
+    ~AsyncFightLog();
+
+    AsyncFightLog(const AsyncFightLog&) = delete;
+    AsyncFightLog& operator=(const AsyncFightLog&) = delete;
+
+    bool open(const std::string& path, const World& world);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    void append(const FightRecord& record);
+
+    uint64_t getWritten() const { return written.load(std::memory_order_relaxed); }
+    uint64_t getStalls() const { return stalls.load(std::memory_order_relaxed); }
+    // A batch could not be written; records drained after that are dropped.
+    bool hasFailed() const { return failed.load(std::memory_order_relaxed); }
+    // Per-thread rings allocated so far: one per thread that appended.
+    size_t getRings();
+
+private:
+    struct Ring {
+        static const size_t kCapacity = 4096;
+        FightRecord records[kCapacity];
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+    };
+
+    Ring& localRing();
+    size_t drain(std::vector<FightRecord>& batch);
+    void writerLoop();
+
+    const uint64_t instanceId;
+    std::FILE* file = nullptr;
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+    // One ring per appending thread, found here when the thread's cached
+    // ring belongs to another log.
+    std::unordered_map<std::thread::id, Ring*> ringOf;
+    std::thread writer;
+    std::atomic<bool> stopping{false};
+    std::mutex wakeMutex;
+    std::condition_variable wakeCV;
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> stalls{0};
+    std::atomic<bool> failed{false};
+};
+
+class FightLogReader {
+public:
+    bool open(const std::string& path);
+    bool next(FightRecord& record);
+
+    const std::vector<std::string>& getNames() const { return names; }
+    std::string nameOf(uint32_t id, uint8_t type) const;
+    // True when slot `id` still held the NPC named in the table.
+    bool knows(uint32_t id, uint32_t generation) const {
+        return id < generations.size() && generations[id] == generation;
+    }
+
+private:
+    std::ifstream is;
+    std::vector<std::string> names;
+    std::vector<uint32_t> generations;
+};
+
+// Formats a record the way FileObserver writes log.txt; losses print nothing.
+// Returns false and writes nothing when either NPC is not the one the name
+// table knows for its slot.
+bool writeTextRecord(std::ostream& os, const FightRecord& record, const FightLogReader& reader);
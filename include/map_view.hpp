@@ -0,0 +1,53 @@
+#pragma once
+
+#include "occupancy_grid.hpp"
+#include <string>
+#include <vector>
+
+// Renders an OccupancyGrid as one character per `zoom` x `zoom` grid cells:
+// the glyph of the most numerous species there, or '.' when empty. Within a
+// viewport of at most maxCols x maxRows characters starting at (originCol,
+// originRow) in display coordinates.
+//
+// In ANSI mode the first frame clears the screen, draws everything and sets
+// the scroll region to the lines below the map; later frames only move the
+// cursor to the characters that changed since the last frame and rewrite
+// those. Plain mode always returns the whole map as text. Writing "\x1b[r"
+// at exit gives the terminal its full scroll region back.
+class MapView {
+public:
+    MapView(const OccupancyGrid& grid, int zoom = 1, int maxCols = 120, int maxRows = 40);
+
+    void setZoom(int zoom);
+    void setOrigin(int col, int row);
+    int getZoom() const { return zoom; }
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+
+    // Forces the next ANSI frame to redraw the whole view.
+    void invalidate() { drawn = false; }
+
+    // Returns the bytes to write for this frame, meant for a single write.
+    std::string render(bool ansi) { return render(grid, ansi); }
+    // Renders `source` instead, e.g. a grid frozen in a WorldFrame; it must
+    // have the geometry of the grid the view was built for.
+    std::string render(const OccupancyGrid& source, bool ansi);
+
+    // Terminal rows taken by an ANSI frame (title and map); output below
+    // that line is left alone.
+    int frameHeight() const { return rows + 1; }
+
+private:
+    void resize();
+    char glyphAt(const OccupancyGrid& source, int col, int row) const;
+    std::string title() const;
+
+    const OccupancyGrid& grid;
+    int zoom;
+    int maxCols, maxRows;
+    int originCol = 0, originRow = 0;
+    int cols = 0, rows = 0;
+    bool drawn = false;
+    std::vector<char> frame;
+    std::vector<char> next;
+};
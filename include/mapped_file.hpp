@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Uses mmap where available and falls back
+// to reading the file into memory elsewhere.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return begin; }
+    size_t size() const { return length; }
+    bool isOpen() const { return opened; }
+
+private:
+    const char* begin = nullptr;
+    size_t length = 0;
+    bool opened = false;
+    bool mapped = false;
+    std::vector<char> buffer;
+};
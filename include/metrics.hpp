@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Built with -DNPC_METRICS=0 every counter, timer and timed lock below
+// compiles to nothing; the registry and exporters stay so callers need no
+// #ifs, they just report zeros.
+#ifndef NPC_METRICS
+#define NPC_METRICS 1
+#endif
+
+enum class Counter : size_t {
+    Ticks,
+    PairsTested,
+    ContactsFound,
+    TasksQueued,
+    TasksDropped,
+    TasksCoalesced,
+    ClaimFailures,
+    Fights,
+    Kills,
+    ObserverCalls,
+    TilesActive,
+    TilesDormant,
+    Count
+};
+
+// The first four follow TickPhase order so a phase index maps directly.
+enum class Timer : size_t {
+    PhaseMove,
+    PhaseDetectContacts,
+    PhaseResolveFights,
+    PhaseNotify,
+    ObserverCall,
+    Count
+};
+
+const char* counterName(Counter counter);
+const char* timerName(Timer timer);
+
+// Power-of-two latency buckets: bucket b counts samples below 2^b ns, the
+// last bucket takes everything longer. Recording is two relaxed increments.
+class LatencyHistogram {
+public:
+    static constexpr size_t kBuckets = 40;
+
+    void record(uint64_t ns);
+    void reset();
+
+    uint64_t count() const { return samples.load(std::memory_order_relaxed); }
+    uint64_t sumNs() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t bucket(size_t b) const { return buckets[b].load(std::memory_order_relaxed); }
+    // Upper bound of the bucket holding the q-th quantile, in ns.
+    uint64_t quantileNs(double q) const;
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> sum{0};
+};
+
+class Metrics {
+public:
+    static Metrics& global();
+
+    void add(Counter counter, uint64_t n) {
+        counters[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+    void record(Timer timer, uint64_t ns) { timers[static_cast<size_t>(timer)].record(ns); }
+
+    uint64_t get(Counter counter) const {
+        return counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    const LatencyHistogram& histogram(Timer timer) const { return timers[static_cast<size_t>(timer)]; }
+
+    void reset();
+    void writeJson(std::ostream& os) const;
+    void writePrometheus(std::ostream& os) const;
+
+private:
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::Count)> counters{};
+    std::array<LatencyHistogram, static_cast<size_t>(Timer::Count)> timers;
+};
+
+inline void countEvent(Counter counter, uint64_t n = 1) {
+#if NPC_METRICS
+    Metrics::global().add(counter, n);
+#else
+    (void)counter;
+    (void)n;
+#endif
+}
+
+// Records the lifetime of the scope into a timer's histogram.
+class ScopedTimer {
+public:
+#if NPC_METRICS
+    explicit ScopedTimer(Timer timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        Metrics::global().record(timer, static_cast<uint64_t>(ns.count()));
+    }
+#else
+    explicit ScopedTimer(Timer) {}
+#endif
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+#if NPC_METRICS
+private:
+    Timer timer;
+    std::chrono::steady_clock::time_point start;
+#endif
+};
+
+enum class MetricsFormat { Json, Prometheus };
+
+// Rewrites a metrics file every `interval` from a background thread. Each
+// dump goes to "<path>.tmp" first and is renamed over `path`, so scrapers
+// never see a half-written file.
+class MetricsDumper {
+public:
+    MetricsDumper() = default;
+    ~MetricsDumper();
+
+    MetricsDumper(const MetricsDumper&) = delete;
+    MetricsDumper& operator=(const MetricsDumper&) = delete;
+
+    // Writes a first dump right away; returns false, without starting the
+    // thread, when `path` cannot be written.
+    bool start(const std::string& path, MetricsFormat format, std::chrono::milliseconds interval);
+    // Stops the thread and writes one final dump.
+    void stop();
+    bool dump() const;
+
+private:
+    std::string path;
+    MetricsFormat format = MetricsFormat::Json;
+    std::chrono::milliseconds interval{1000};
+    std::thread thread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+// Append-only store of interned NPC names. Equal names share one copy and
+// one id. Characters live in chunks that never move, so ids and
+// the views returned by get() stay valid for the table's lifetime. The
+// index is an open-addressed table of ids, so interning allocates nothing
+// per name.
+class NameTable {
+public:
+    uint32_t intern(std::string_view name);
+    // Replaces the contents with `names` interned in order and writes each
+    // one's id to `ids`: the same ids as clear() then intern() in turn, but
+    // hashing, deduplication and copying run on the pool.
+    void assign(const std::string_view* names, size_t count, uint32_t* ids, ThreadPool& pool);
+    // Sizes the index for `count` names so bulk loads do not rehash.
+    void reserve(size_t count);
+    std::string_view get(uint32_t id) const { return views[id]; }
+
+    size_t size() const { return views.size(); }
+    // Characters stored, not counting chunk slack.
+    size_t bytes() const { return stored; }
+    void clear();
+
+private:
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    // Slot holding `name`, or the empty slot where it would go.
+    size_t findSlot(std::string_view name, size_t hash) const;
+    void rehash(size_t capacity);
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* current = nullptr;
+    size_t chunkUsed = 0;
+    size_t stored = 0;
+    std::vector<std::string_view> views;
+    // id + 1 per slot, 0 when empty; the size is a power of two kept at
+    // least twice the number of names. Atomic only so assign() can build
+    // the index from several threads; intern() uses relaxed accesses.
+    std::unique_ptr<std::atomic<uint32_t>[]> slots;
+    size_t slotCount = 0;
+};
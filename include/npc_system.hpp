@@ -12,6 +12,9 @@
 #include <stdexcept>
 #include <tuple>
 #include <ostream>
+#include <cstdint>
+#include <atomic>
+#include "species.hpp"
 
 class Visitor;
 class NPC;
@@ -21,79 +24,106 @@ struct IFightObserver {
     virtual void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) = 0;
 };
 
+// NPC state is lock-free. The position is one packed 64-bit atomic, so
+// readers always see a matching (x, y). Alive and claimed are bits of one
+// atomic byte: a kill or a claim is a single compare-and-swap. The observer
+// list is copy-on-write, so notifying never waits on a subscriber.
 class NPC : public std::enable_shared_from_this<NPC> {
 protected:
+    using ObserverList = std::vector<std::shared_ptr<IFightObserver>>;
+
+    static constexpr uint8_t kAlive = 1;
+    static constexpr uint8_t kClaimed = 2;
+
     std::string name;
-    int x, y;
-    bool alive = true;
+    uint32_t id;
     int moveDistance;
     int killDistance;
-    std::vector<std::shared_ptr<IFightObserver>> observers;
-    mutable std::mutex mtx;
+    std::atomic<uint64_t> pos;
+    std::atomic<uint8_t> state{kAlive};
+    std::shared_ptr<const ObserverList> observers;
+    mutable std::atomic<uint64_t> draws{0};
+
+    static uint32_t nextId();
+    static uint64_t pack(int x, int y) {
+        return static_cast<uint32_t>(x) | (static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32);
+    }
+    static int unpackX(uint64_t p) { return static_cast<int32_t>(static_cast<uint32_t>(p)); }
+    static int unpackY(uint64_t p) { return static_cast<int32_t>(static_cast<uint32_t>(p >> 32)); }
 
 public:
     NPC(const std::string& n, int x_, int y_, int moveDist, int killDist)
-        : name(n), x(x_), y(y_), moveDistance(moveDist), killDistance(killDist) {}
+        : name(n), id(nextId()), moveDistance(moveDist), killDistance(killDist), pos(pack(x_, y_)) {}
+    NPC(const std::string& n, int x_, int y_, NpcType type)
+        : NPC(n, x_, y_, species(type).moveDistance, species(type).killDistance) {}
     virtual ~NPC() = default;
 
     virtual void accept(Visitor& visitor) = 0;
-    virtual bool fight(std::shared_ptr<NPC> other) = 0;
+    // Matchups and dice come from the species table (see species.hpp). Both
+    // NPCs are claimed for the duration; returns false without fighting if
+    // either is dead or already in another fight.
+    virtual bool fight(NPC& other);
+    bool fight(const std::shared_ptr<NPC>& other) { return other && fight(*other); }
 
     void moveRandomly(int mapSizeX, int mapSizeY);
     bool isInRangeForKill(const NPC& other) const;
     int rollDice() const;
 
-    virtual std::string getType() const = 0;
+    virtual std::string getType() const { return typeName(typeId()); }
+    virtual NpcType typeId() const = 0;
     const std::string& getName() const { return name; }
-    int getX() const { return x; }
-    int getY() const { return y; }
-    bool isAlive() const { return alive; }
-    void kill() { alive = false; }
-    
+    uint32_t getId() const { return id; }
+    int getX() const { return unpackX(pos.load(std::memory_order_relaxed)); }
+    int getY() const { return unpackY(pos.load(std::memory_order_relaxed)); }
+    int getMoveDistance() const { return moveDistance; }
+    int getKillDistance() const { return killDistance; }
+    bool isAlive() const { return state.load(std::memory_order_acquire) & kAlive; }
+    // True only for the call that actually turned alive into dead.
+    bool kill();
+
+    // Claims a live, unclaimed NPC; fails without side effects otherwise.
+    bool tryClaim();
+    void release() { state.fetch_and(static_cast<uint8_t>(~kClaimed), std::memory_order_release); }
+
     std::tuple<int, int> position() const;
     void subscribe(std::shared_ptr<IFightObserver> observer);
-    void fight_notify(const std::shared_ptr<NPC> defender, bool win);
+    void fight_notify(const std::shared_ptr<NPC>& defender, bool win);
     virtual bool is_close(const std::shared_ptr<NPC> &other, size_t distance);
     
     virtual void print(std::ostream& os) const;
 
-    virtual void save(std::ofstream& os) const = 0;
+    virtual void save(std::ofstream& os) const;
     static std::shared_ptr<NPC> load(std::ifstream& is);
+    static std::shared_ptr<NPC> create(NpcType type, const std::string& name, int x, int y);
 };
 
 class Bear : public NPC {
 public:
-    Bear(const std::string& n, int x, int y) : NPC(n, x, y, 5, 10) {}
-    std::string getType() const override { return "Bear"; }
+    Bear(const std::string& n, int x, int y) : NPC(n, x, y, NpcType::Bear) {}
+    NpcType typeId() const override { return NpcType::Bear; }
     void accept(Visitor& visitor) override;
-    bool fight(std::shared_ptr<NPC> other) override;
-    void save(std::ofstream& os) const override;
 };
 
 class Duck : public NPC {
 public:
-    Duck(const std::string& n, int x, int y) : NPC(n, x, y, 50, 10) {}
-    std::string getType() const override { return "Duck"; }
+    Duck(const std::string& n, int x, int y) : NPC(n, x, y, NpcType::Duck) {}
+    NpcType typeId() const override { return NpcType::Duck; }
     void accept(Visitor& visitor) override;
-    bool fight(std::shared_ptr<NPC> other) override;
-    void save(std::ofstream& os) const override;
 };
 
 class Desman : public NPC {
 public:
-    Desman(const std::string& n, int x, int y) : NPC(n, x, y, 5, 20) {}
-    std::string getType() const override { return "Desman"; }
+    Desman(const std::string& n, int x, int y) : NPC(n, x, y, NpcType::Desman) {}
+    NpcType typeId() const override { return NpcType::Desman; }
     void accept(Visitor& visitor) override;
-    bool fight(std::shared_ptr<NPC> other) override;
-    void save(std::ofstream& os) const override;
 };
 
 class Visitor {
 public:
     virtual ~Visitor() = default;
-    virtual void visit(std::shared_ptr<Bear> bear) = 0;
-    virtual void visit(std::shared_ptr<Duck> duck) = 0;
-    virtual void visit(std::shared_ptr<Desman> desman) = 0;
+    virtual void visit(Bear& bear) = 0;
+    virtual void visit(Duck& duck) = 0;
+    virtual void visit(Desman& desman) = 0;
 };
 
 class BattleVisitor : public Visitor {
@@ -101,12 +131,14 @@ class BattleVisitor : public Visitor {
     std::string _killer, _victim;
     bool _killOccurred = false;
 
+    void engage(NPC& target);
+
 public:
-    BattleVisitor(std::shared_ptr<NPC> a) : attacker(a) {}
+    BattleVisitor(std::shared_ptr<NPC> a) : attacker(std::move(a)) {}
 
-    void visit(std::shared_ptr<Bear> target) override;
-    void visit(std::shared_ptr<Duck> target) override;
-    void visit(std::shared_ptr<Desman> target) override;
+    void visit(Bear& target) override { engage(target); }
+    void visit(Duck& target) override { engage(target); }
+    void visit(Desman& target) override { engage(target); }
 
     bool wasKill() const { return _killOccurred; }
     std::string getKiller() const { return _killer; }
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "species.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Live NPC counts per species for every cellSize x cellSize block of the
+// map. World keeps it current as NPCs spawn, move and die, so views read it
+// without touching the NPC columns. Counters are relaxed atomics: movers on
+// different threads may update the same cell, and a concurrent reader sees
+// each cell's count as of some recent moment.
+class OccupancyGrid {
+public:
+    OccupancyGrid(int mapSizeX, int mapSizeY, int cellSize);
+
+    // Takes over the geometry and current counts of `other`; used to freeze
+    // the grid into a published world frame between ticks.
+    void copyFrom(const OccupancyGrid& other);
+
+    int getCellSize() const { return cellSize; }
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+
+    void add(NpcType type, int x, int y) { bump(type, x, y, 1); }
+    void remove(NpcType type, int x, int y) { bump(type, x, y, static_cast<uint32_t>(-1)); }
+    // Only touches the counters when the NPC actually changes cell.
+    void move(NpcType type, int fromX, int fromY, int toX, int toY);
+    void clear();
+
+    uint32_t count(int col, int row, NpcType type) const {
+        return counts[slot(col, row, type)].load(std::memory_order_relaxed);
+    }
+    uint32_t total(int col, int row) const;
+
+private:
+    size_t cellIndex(int x, int y) const {
+        int c = x / cellSize, r = y / cellSize;
+        c = c < 0 ? 0 : (c >= cols ? cols - 1 : c);
+        r = r < 0 ? 0 : (r >= rows ? rows - 1 : r);
+        return static_cast<size_t>(r) * cols + c;
+    }
+    size_t slot(int col, int row, NpcType type) const {
+        return (static_cast<size_t>(row) * cols + col) * kSpeciesCount + static_cast<size_t>(type);
+    }
+    void bump(NpcType type, int x, int y, uint32_t delta) {
+        counts[cellIndex(x, y) * kSpeciesCount + static_cast<size_t>(type)].fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    int cellSize;
+    int cols, rows;
+    std::unique_ptr<std::atomic<uint32_t>[]> counts;
+};
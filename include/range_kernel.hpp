@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class RangeKernelIsa { Scalar, SSE2, AVX2 };
+
+// Tests one attacker at (ax, ay) against up to 64 candidates stored as
+// separate x/y arrays. Bit k of the result is set when candidate k lies
+// within `distance` (squared integer distance, so it agrees exactly with
+// std::hypot(dx, dy) <= distance). The vector path is picked once at
+// runtime from what the CPU supports.
+uint64_t rangeMask(int ax, int ay, const int* xs, const int* ys, size_t count, int distance);
+
+// Same as rangeMask with an explicit code path; falls back to the scalar
+// path when the requested one is not available.
+uint64_t rangeMaskWith(RangeKernelIsa isa, int ax, int ay, const int* xs, const int* ys, size_t count, int distance);
+
+RangeKernelIsa activeRangeKernel();
+bool isRangeKernelSupported(RangeKernelIsa isa);
+const char* rangeKernelName(RangeKernelIsa isa);
+
+inline bool inRange(int ax, int ay, int bx, int by, int distance) {
+    return (rangeMask(ax, ay, &bx, &by, 1, distance) & 1) != 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include "timing_wheel.hpp"
+#include "world.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Session recording, version 1. Movement and dice are already pure
+// functions of (seed, index, tick); what a run does not determine is the
+// order in which battle workers resolve fights. A recording keeps the
+// starting world as a snapshot next to the log ("<path>.snap") and, per
+// tick, every fight in the order it happened:
+//
+//   ReplayHeader
+//   per tick: ReplayTick, ReplayStep[count]
+//
+// Fights on the same NPC are serialised by its claim and each step is
+// appended while the claims are held, so the log order is one the run
+// actually took.
+struct ReplayHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t seed;
+    uint32_t rated;      // 1 when NPCs moved on a RateScheduler
+    uint32_t speciesCount;
+    uint32_t moveEvery[8];
+    uint32_t attackEvery[8];
+};
+
+struct ReplayTick {
+    uint64_t tick;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct ReplayStep {
+    uint32_t attacker;
+    uint32_t defender;
+    uint8_t result;     // FightResult
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(ReplayHeader) == 96, "ReplayHeader layout is part of the file format");
+static_assert(sizeof(ReplayStep) == 12, "ReplayStep layout is part of the file format");
+static_assert(kSpeciesCount <= 8, "ReplayHeader holds rates for up to 8 species");
+
+class ReplayRecorder {
+public:
+    ReplayRecorder() = default;
+    ~ReplayRecorder() { close(); }
+
+    ReplayRecorder(const ReplayRecorder&) = delete;
+    ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+    // Saves `world` as it stands as the starting point. Pass the rate
+    // scheduler when NPCs move on one. Throws std::runtime_error on I/O
+    // errors.
+    void open(const std::string& path, const World& world, const RateScheduler* rates = nullptr);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    // Thread-safe; call with both NPCs still claimed.
+    void record(size_t attacker, size_t defender, FightResult result);
+    // Writes the steps recorded since the last call as tick `tick`.
+    void endTick(uint64_t tick);
+
+    uint64_t getSteps() const { return steps; }
+
+private:
+    std::FILE* file = nullptr;
+    std::mutex mtx;
+    std::vector<ReplayStep> pending;
+    uint64_t steps = 0;
+};
+
+struct ReplayStats {
+    uint64_t ticks = 0;
+    uint64_t fights = 0;
+    // Steps whose outcome differed from the recording; nonzero means the
+    // simulation no longer behaves as it did when recorded.
+    uint64_t mismatches = 0;
+};
+
+// Loads the recording's starting world into `world` and re-runs every tick
+// single-threaded for fights, without contact detection or battle queues.
+// Throws std::runtime_error on a missing or corrupt recording.
+ReplayStats replaySession(World& world, const std::string& path, ThreadPool& pool);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+enum class RngStream : uint64_t { Move = 1, Dice = 2, Spawn = 3 };
+
+// Counter-based generator: every value is a pure function of
+// (seed, id, tick, stream, draw index), so there is no shared state between
+// threads and a run is reproduced from the seed alone.
+class CounterRng {
+    uint64_t key;
+    uint64_t counter = 0;
+
+public:
+    CounterRng(uint64_t seed, uint64_t id, uint64_t tick, RngStream stream, uint64_t substream = 0);
+
+    uint64_t next();
+    // Uniform integer in [lo, hi].
+    int uniform(int lo, int hi);
+};
+
+uint64_t splitmix64(uint64_t z);
+
+void setSimulationSeed(uint64_t seed);
+uint64_t simulationSeed();
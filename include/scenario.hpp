@@ -0,0 +1,54 @@
+#pragma once
+
+#include "species.hpp"
+#include "thread_pool.hpp"
+#include "world.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class Distribution { Uniform, Clustered, Density };
+
+// Relative spawn weight per pixel, read from a grayscale PGM image: brighter
+// pixels draw more NPCs, black ones none. The image is stretched over the
+// whole map.
+struct DensityMap {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> weights;
+};
+
+// Reads binary (P5) or ASCII (P2) PGM with a maxval up to 255. Throws
+// std::runtime_error on unreadable or unsupported files.
+DensityMap loadDensityMap(const std::string& path);
+
+constexpr std::array<uint32_t, kSpeciesCount> equalRatios() {
+    std::array<uint32_t, kSpeciesCount> ratios{};
+    for (auto& r : ratios) r = 1;
+    return ratios;
+}
+
+struct ScenarioSpec {
+    size_t count = 0;
+    uint64_t seed = 0;
+    // Relative weights in NpcType order; their sum must fit in an int.
+    std::array<uint32_t, kSpeciesCount> ratios = equalRatios();
+    Distribution distribution = Distribution::Uniform;
+    // Clustered: NPCs gather around `clusters` random centres, at most
+    // `clusterRadius` away on each axis and denser towards the middle.
+    size_t clusters = 8;
+    int clusterRadius = 20;
+    // Density: required for Distribution::Density.
+    std::shared_ptr<const DensityMap> density;
+};
+
+// Replaces the world's population with `spec.count` NPCs on the world's
+// current map. Every NPC is a pure function of (seed, index), so chunks
+// are generated in parallel into preallocated columns and handed to the
+// world in one bulk assign; the result does not depend on the pool size.
+// Names are "<Type><index>". Throws std::invalid_argument on an empty or
+// oversized ratio table or a Density spec without a map.
+void generateScenario(World& world, const ScenarioSpec& spec, ThreadPool& pool);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+enum class TickPhase { Move, DetectContacts, ResolveFights, Notify };
+
+// Runs the simulation as a sequence of ticks, each made of the four phases
+// in order. Phases split their own work over the shared pool; a phase only
+// starts once the previous one has finished.
+class TickScheduler {
+public:
+    using Phase = std::function<void(uint64_t tick)>;
+
+    // An interval of zero runs ticks back to back ("as fast as possible").
+    TickScheduler(ThreadPool& pool, std::chrono::milliseconds tickInterval);
+
+    void setPhase(TickPhase phase, Phase fn);
+    void runTick();
+    // Runs until `running` is cleared or `maxTicks` ticks have run (0 means
+    // no limit).
+    void run(const std::atomic<bool>& running, uint64_t maxTicks = 0);
+
+    ThreadPool& getPool() { return pool; }
+    uint64_t getTick() const { return tick; }
+    std::chrono::milliseconds getTickInterval() const { return tickInterval; }
+
+private:
+    ThreadPool& pool;
+    std::chrono::milliseconds tickInterval;
+    std::array<Phase, 4> phases;
+    uint64_t tick = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include "world.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Binary world snapshot, version 1. All fields are little-endian and every
+// section starts on an 8-byte boundary:
+//
+//   SnapshotHeader
+//   int32  x[count]
+//   int32  y[count]
+//   uint8  alive[count]
+//   uint8  type[count]
+//   uint64 nameOffsets[count + 1]   (into the name blob)
+//   char   names[nameBytes]
+//
+// The checksum covers everything after the header.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int32_t mapSizeX;
+    int32_t mapSizeY;
+    uint64_t seed;
+    uint64_t tick;
+    uint64_t count;
+    uint64_t nameBytes;
+    uint64_t checksum;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader layout is part of the file format");
+
+const uint64_t kSnapshotChecksumBasis = 0xcbf29ce484222325ULL;
+
+// FNV-1a over 64-bit words; chainable over consecutive 8-byte-padded sections.
+uint64_t snapshotChecksum(const char* data, size_t size, uint64_t hash = kSnapshotChecksumBasis);
+
+// Both throw std::runtime_error on I/O errors or a corrupt file.
+void saveSnapshot(const World& world, const std::string& path);
+void loadSnapshot(World& world, const std::string& path);
+
+// The "<Type> <name> <x> <y>" text format written by NPC::save.
+void exportText(const World& world, std::ostream& os);
+void importText(World& world, std::istream& is);
+
+// Bulk loader for the text format: maps the file, splits it at line
+// boundaries across the pool and parses the chunks in parallel straight
+// into packed columns, then replaces the world's population in one step.
+// Blank lines are skipped. Throws std::runtime_error naming the first
+// malformed line as "<path>:<line>: <problem>", or before parsing when the
+// file holds more records than a World has slots (NpcHandle::kMaxSlots).
+void loadTextFile(World& world, const std::string& path, ThreadPool& pool);
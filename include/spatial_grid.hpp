@@ -0,0 +1,101 @@
+#pragma once
+
+#include "npc_system.hpp"
+#include "world.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Uniform grid over NPC positions. The cell size equals the largest kill
+// distance, so every pair that can be in range lies in the same or in
+// adjacent cells and only those pairs are ever tested.
+class SpatialGrid {
+public:
+    using Contact = std::pair<size_t, size_t>;
+
+    void rebuild(const std::vector<std::shared_ptr<NPC>>& npcs);
+    void rebuild(const World& world);
+    // Only the listed NPCs (dead ones are skipped).
+    void rebuild(const World& world, const std::vector<size_t>& indices);
+
+    template <typename F>
+    void forEachCandidatePair(F&& f) const;
+
+    // Same result as checking npcs[i]->isInRangeForKill(*npcs[j]) for every
+    // i < j, sorted by (i, j).
+    std::vector<Contact> findContacts(const std::vector<std::shared_ptr<NPC>>& npcs);
+    std::vector<Contact> findContacts(const World& world);
+    std::vector<Contact> findContacts(const World& world, ThreadPool& pool);
+    // Contacts among the listed NPCs only, as global indices.
+    std::vector<Contact> findContacts(const World& world, const std::vector<size_t>& indices);
+
+    int getCellSize() const { return cellSize; }
+
+private:
+    struct Entry {
+        uint64_t cell;
+        size_t index;
+    };
+
+    static uint64_t cellKey(int cx, int cy) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+    }
+    int cellOf(int coord) const;
+    template <typename IndexAt>
+    void rebuildFrom(const World& world, size_t count, IndexAt indexAt);
+    void buildCells();
+    void gatherPositions(const World& world, size_t begin, size_t end);
+    void scanCells(const World& world, size_t firstCell, size_t lastCell, std::vector<Contact>& out) const;
+
+    // Calls f(a, begin, end) for every entry a of the cells in
+    // [firstCell, lastCell) and each block [begin, end) of entries in its own
+    // or a forward-neighbour cell that it must be tested against. Blocks are
+    // contiguous, so positions can be checked in batches.
+    template <typename F>
+    void forEachCandidateBlock(F&& f, size_t firstCell, size_t lastCell) const;
+
+    int cellSize = 1;
+    std::vector<Entry> entries;
+    std::vector<int> sortedX, sortedY;
+    std::vector<uint64_t> cellList;
+    std::unordered_map<uint64_t, std::pair<size_t, size_t>> cells;
+};
+
+template <typename F>
+void SpatialGrid::forEachCandidateBlock(F&& f, size_t firstCell, size_t lastCell) const {
+    static const int forward[4][2] = {{1, -1}, {1, 0}, {1, 1}, {0, 1}};
+
+    for (size_t c = firstCell; c < lastCell; ++c) {
+        const uint64_t key = cellList[c];
+        const auto& range = cells.find(key)->second;
+        const int cx = static_cast<int>(static_cast<uint32_t>(key >> 32));
+        const int cy = static_cast<int>(static_cast<uint32_t>(key));
+
+        for (size_t a = range.first; a < range.second; ++a) {
+            f(a, a + 1, range.second);
+        }
+
+        for (const auto& d : forward) {
+            auto it = cells.find(cellKey(cx + d[0], cy + d[1]));
+            if (it == cells.end()) continue;
+            for (size_t a = range.first; a < range.second; ++a) {
+                f(a, it->second.first, it->second.second);
+            }
+        }
+    }
+}
+
+template <typename F>
+void SpatialGrid::forEachCandidatePair(F&& f) const {
+    forEachCandidateBlock([&](size_t a, size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            size_t i = entries[a].index;
+            size_t j = entries[b].index;
+            if (i < j) f(i, j);
+            else f(j, i);
+        }
+    }, 0, cellList.size());
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class NpcType : uint8_t { Bear, Duck, Desman };
+
+struct SpeciesInfo {
+    const char* name;
+    char glyph;
+    int moveDistance;
+    int killDistance;
+    int diceSides;
+};
+
+// One row per species, in NpcType order. Adding a species means adding an
+// enum value, a row here and a row/column in kCanKill, plus an NPC subclass
+// in npc_system.hpp, its Visitor and BattleVisitor overloads and a case in
+// NPC::create().
+constexpr SpeciesInfo kSpecies[] = {
+    {"Bear", 'B', 5, 10, 6},
+    {"Duck", 'D', 50, 10, 6},
+    {"Desman", 'S', 5, 20, 6},
+};
+
+constexpr size_t kSpeciesCount = sizeof(kSpecies) / sizeof(kSpecies[0]);
+
+// kCanKill[attacker][target]: whether a fight started by `attacker` can
+// ever happen.
+constexpr bool kCanKill[kSpeciesCount][kSpeciesCount] = {
+    //           Bear   Duck   Desman
+    /* Bear   */ {false, true, true},
+    /* Duck   */ {false, false, false},
+    /* Desman */ {true, false, false},
+};
+
+constexpr const SpeciesInfo& species(NpcType type) {
+    return kSpecies[static_cast<size_t>(type)];
+}
+
+constexpr const char* typeName(NpcType type) {
+    return species(type).name;
+}
+
+constexpr bool canAttack(NpcType attacker, NpcType target) {
+    return kCanKill[static_cast<size_t>(attacker)][static_cast<size_t>(target)];
+}
+
+constexpr bool canAttackAnyone(NpcType attacker) {
+    for (size_t t = 0; t < kSpeciesCount; ++t) {
+        if (kCanKill[static_cast<size_t>(attacker)][t]) return true;
+    }
+    return false;
+}
+
+constexpr int maxKillDistance() {
+    int result = 0;
+    for (const auto& s : kSpecies) {
+        if (s.killDistance > result) result = s.killDistance;
+    }
+    return result;
+}
+
+static_assert(species(NpcType::Desman).killDistance == 20, "species table is out of NpcType order");
+static_assert(canAttack(NpcType::Bear, NpcType::Duck) && !canAttack(NpcType::Duck, NpcType::Bear), "fight matrix");
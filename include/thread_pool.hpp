@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool: each worker pops from the back of its own deque and
+// steals from the front of the others when it runs dry. Threads that wait on
+// a parallelFor help by running queued tasks, so nested calls cannot
+// deadlock.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    void submit(std::function<void()> task);
+
+    // Splits [begin, end) into chunks of at most `grain` items and calls
+    // body(chunkBegin, chunkEnd) for each; returns when all chunks are done.
+    template <typename F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F&& body);
+
+private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    size_t selfIndex() const;
+    bool tryRunOne(size_t self);
+    void workerLoop(size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+};
+
+template <typename F>
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, F&& body) {
+    if (begin >= end) return;
+    grain = std::max<size_t>(grain, 1);
+    if (end - begin <= grain || workers.empty()) {
+        body(begin, end);
+        return;
+    }
+
+    std::atomic<size_t> remaining{(end - begin + grain - 1) / grain};
+    for (size_t b = begin; b < end; b += grain) {
+        size_t e = std::min(end, b + grain);
+        submit([&body, &remaining, b, e]() {
+            body(b, e);
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+
+    while (remaining.load(std::memory_order_acquire) != 0) {
+        if (!tryRunOne(selfIndex())) std::this_thread::yield();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "spatial_grid.hpp"
+#include "thread_pool.hpp"
+#include "world.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Splits a large map into square tiles so each worker handles one region at
+// a time. A tile owns the NPCs standing in it and keeps its own index list
+// and contact grid across ticks, so repeated work on a tile touches the same
+// memory.
+//
+// Contact detection gives every tile a ghost border of width halo (at least
+// the largest kill distance): the tile scans its own NPCs together with the
+// neighbours' NPCs inside that border. A pair is reported only by the tile
+// that owns its attacker (the lower index), so pairs across a border are
+// found exactly once and the result matches SpatialGrid::findContacts.
+//
+// NPCs leave their tile's list only in migrate(), which must run between
+// moving and detecting contacts.
+//
+// With sleeping enabled, a tile whose own species cannot attack any species
+// present in it or its neighbours is dormant: its NPCs still move and
+// migrate, but contact detection skips it. Contacts are then limited to
+// pairs that can actually fight, since the others are exactly what dormancy
+// leaves out.
+class TileDecomposition {
+public:
+    TileDecomposition(int mapSizeX, int mapSizeY, int tileSize, int halo = maxKillDistance());
+
+    int getTileSize() const { return tileSize; }
+    int getHalo() const { return halo; }
+    size_t tileCount() const { return tiles.size(); }
+    size_t tileOf(int x, int y) const;
+    const std::vector<size_t>& owned(size_t tile) const { return tiles[tile].owned; }
+
+    // Rebuilds ownership of every live NPC from scratch; call after the
+    // population changes outside move/migrate (spawning, loading).
+    void assign(const World& world);
+    // Moves each tile's NPCs; tiles run in parallel.
+    void move(World& world, ThreadPool& pool);
+    // Hands NPCs that crossed a border to their new tile and drops the dead.
+    void migrate(const World& world, ThreadPool& pool);
+    std::vector<SpatialGrid::Contact> findContacts(const World& world, ThreadPool& pool);
+
+    void setSleeping(bool enabled) { sleeping = enabled; }
+    bool isSleeping() const { return sleeping; }
+
+    // NPCs moved to another tile by migrate() since construction.
+    uint64_t getMigrations() const { return migrations; }
+    // Tiles scanned by the last findContacts(), and the mean fraction of
+    // tiles scanned per call since construction.
+    size_t getActiveTiles() const { return activeTiles; }
+    double getActiveFraction() const;
+
+private:
+    struct Tile {
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        uint32_t species = 0;
+        bool active = false;
+        std::vector<size_t> owned;
+        std::vector<size_t> leaving;
+        std::vector<size_t> scratch;
+        std::vector<SpatialGrid::Contact> contacts;
+        SpatialGrid grid;
+    };
+
+    void gatherGhosts(const World& world, size_t t);
+    bool canFight(size_t t) const;
+
+    int tileSize;
+    int halo;
+    int cols, rows;
+    std::vector<Tile> tiles;
+    bool sleeping = false;
+    uint64_t migrations = 0;
+    size_t activeTiles = 0;
+    uint64_t activeTileScans = 0;
+    uint64_t tileScans = 0;
+};
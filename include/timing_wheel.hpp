@@ -0,0 +1,96 @@
+#pragma once
+
+#include "spatial_grid.hpp"
+#include "species.hpp"
+#include "thread_pool.hpp"
+#include "world.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel keyed by tick. Four levels of 64 slots cover
+// 2^24 ticks ahead; farther events sit in the top level and are placed
+// again each time it turns. Scheduling is O(1), and advancing costs only
+// the events that fire or cascade on that tick.
+class TimingWheel {
+public:
+    explicit TimingWheel(uint64_t now = 0) : now(now) {}
+
+    uint64_t getNow() const { return now; }
+    size_t size() const { return pending; }
+
+    // Events due at or before the current tick fire on the next advance().
+    void schedule(uint64_t payload, uint64_t due);
+    // Moves to the next tick and appends the payloads due on it to `fired`.
+    void advance(std::vector<uint64_t>& fired);
+
+private:
+    static constexpr int kLevelBits = 6;
+    static constexpr size_t kSlots = size_t{1} << kLevelBits;
+    static constexpr int kLevels = 4;
+
+    struct Event {
+        uint64_t due;
+        uint64_t payload;
+    };
+
+    void place(const Event& event);
+
+    std::array<std::array<std::vector<Event>, kSlots>, kLevels> slots;
+    std::vector<Event> cascading;
+    uint64_t now;
+    size_t pending = 0;
+};
+
+// How often an NPC moves and may start a fight, in ticks.
+struct UpdateRate {
+    uint32_t moveEvery = 1;
+    uint32_t attackEvery = 1;
+};
+
+// Drives NPC updates from a timing wheel so each tick only touches the
+// NPCs due on it. Rates come from the NPC's species when it is added. An
+// NPC with moveEvery k moves on every k-th tick, staggered by index so a
+// species does not move all at once. Moves still draw from (seed, index,
+// tick), so with every rate at 1 the result is the fixed tick's.
+//
+// Events hold NPC handles, moves and attacks on a wheel each. A dead NPC's
+// events lapse when they fire, and NPCs spawned after scheduleAll() must be
+// passed to add().
+class RateScheduler {
+public:
+    explicit RateScheduler(World& world) : world(world), moveWheel(world.getTick()), attackWheel(world.getTick()) {}
+
+    void setRate(NpcType type, UpdateRate rate) { speciesRates[static_cast<size_t>(type)] = rate; }
+    UpdateRate getRate(NpcType type) const { return speciesRates[static_cast<size_t>(type)]; }
+
+    void scheduleAll();
+    void add(size_t npc);
+
+    // Begins the world's next tick and moves the NPCs due on it.
+    void tick(ThreadPool& pool);
+    bool readyToAttack(size_t npc) const { return npc < attackTick.size() && attackTick[npc] == world.getTick(); }
+    // Drops contacts whose attacker is not due to attack this tick.
+    void filterContacts(std::vector<SpatialGrid::Contact>& contacts) const;
+
+    // Events fired by the last tick().
+    size_t getMovesDue() const { return moves.size(); }
+    size_t getAttacksDue() const { return attacksDue; }
+    size_t pendingEvents() const { return moveWheel.size() + attackWheel.size(); }
+
+private:
+    // Only add() calls this, after growing rates to cover npc.
+    void setRate(size_t npc, UpdateRate rate);
+
+    World& world;
+    TimingWheel moveWheel;
+    TimingWheel attackWheel;
+    std::array<UpdateRate, kSpeciesCount> speciesRates{};
+    std::vector<UpdateRate> rates;
+    std::vector<uint64_t> attackTick;
+    std::vector<uint64_t> firedMoves;
+    std::vector<uint64_t> firedAttacks;
+    std::vector<size_t> moves;
+    size_t attacksDue = 0;
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "name_table.hpp"
+#include "npc_system.hpp"
+#include "occupancy_grid.hpp"
+#include "rng.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class EventBus;
+class ThreadPool;
+class World;
+
+// 64-bit reference to a World slot: the low 32 bits are the slot index, the
+// high 32 bits the slot's generation when the handle was taken. Slots of dead
+// NPCs are reused by later adds with the generation bumped, so a handle to
+// the old occupant stops resolving instead of aliasing the newcomer. The
+// all-ones index is reserved for the default (null) handle.
+class NpcHandle {
+public:
+    static constexpr uint32_t kIndexBits = 32;
+    static constexpr size_t kMaxSlots = (uint64_t{1} << kIndexBits) - 1;
+
+    NpcHandle() = default;
+    NpcHandle(size_t index, uint32_t generation)
+        : value(static_cast<uint32_t>(index) | (static_cast<uint64_t>(generation) << kIndexBits)) {}
+
+    size_t index() const { return static_cast<uint32_t>(value); }
+    uint32_t generation() const { return static_cast<uint32_t>(value >> kIndexBits); }
+    uint64_t raw() const { return value; }
+    static NpcHandle fromRaw(uint64_t raw) {
+        NpcHandle h;
+        h.value = raw;
+        return h;
+    }
+
+    bool operator==(NpcHandle other) const { return value == other.value; }
+    bool operator!=(NpcHandle other) const { return value != other.value; }
+    bool operator<(NpcHandle other) const { return value < other.value; }
+
+private:
+    uint64_t value = ~uint64_t{0};
+};
+
+enum class FightResult { NoFight, Lost, Won };
+
+// Non-owning view of one NPC stored in a World. Mirrors the NPC getters so
+// code written against Bear/Duck/Desman reads the same against packed data.
+class NpcRef {
+    World* world;
+    size_t index;
+
+public:
+    NpcRef(World& w, size_t i) : world(&w), index(i) {}
+
+    size_t getIndex() const { return index; }
+    NpcType typeId() const;
+    std::string getType() const;
+    std::string_view getName() const;
+    int getX() const;
+    int getY() const;
+    bool isAlive() const;
+    void kill();
+
+    void moveRandomly();
+    bool isInRangeForKill(const NpcRef& other) const;
+    FightResult fight(const NpcRef& other);
+    std::shared_ptr<NPC> toNpc() const;
+};
+
+// Structure-of-arrays NPC storage. Positions, state and distances live in
+// parallel vectors so movement and range checks are linear scans; names are
+// interned ids and observers are only touched when a fight is reported.
+//
+// Slots are pooled: add() reuses the lowest dead slot before growing, so the
+// columns stay dense under churn. Code that keeps a reference across a tick
+// holds an NpcHandle and resolves it; plain indices are only stable until
+// the next add().
+class World {
+public:
+    World(int mapSizeX, int mapSizeY, uint64_t seed = simulationSeed())
+        : mapSizeX(mapSizeX), mapSizeY(mapSizeY), seed(seed) {}
+
+    size_t add(NpcType type, std::string_view name, int x, int y);
+    size_t add(const NPC& npc);
+    void reserve(size_t count);
+
+    // Replaces the whole population with packed columns in one step; used by
+    // bulk loaders that already hold the data in this layout.
+    void assign(int mapX, int mapY, size_t count, const int* xs, const int* ys,
+                const uint8_t* aliveFlags, const NpcType* types, std::vector<std::string> npcNames);
+    // Same, with names as views into the caller's buffer; they are copied.
+    void assign(int mapX, int mapY, size_t count, const int* xs, const int* ys,
+                const uint8_t* aliveFlags, const NpcType* types, const std::string_view* npcNames);
+    // Same, interning the names on the pool.
+    void assign(int mapX, int mapY, size_t count, const int* xs, const int* ys,
+                const uint8_t* aliveFlags, const NpcType* types, const std::string_view* npcNames, ThreadPool& pool);
+
+    size_t size() const { return x.size(); }
+    size_t aliveCount() const;
+    int getMapSizeX() const { return mapSizeX; }
+    int getMapSizeY() const { return mapSizeY; }
+    // Only meaningful before NPCs are placed; existing positions are not clamped.
+    void setMapSize(int sizeX, int sizeY);
+    uint64_t getSeed() const { return seed; }
+    void setSeed(uint64_t value) { seed = value; }
+    uint64_t getTick() const { return tick; }
+    void setTick(uint64_t value) { tick = value; }
+
+    NpcRef operator[](size_t i) { return NpcRef(*this, i); }
+
+    static constexpr size_t kNoSlot = ~size_t{0};
+    NpcHandle handle(size_t i) const { return NpcHandle(i, generation[i]); }
+    // The slot `h` refers to, or kNoSlot when that slot has been reused.
+    size_t resolve(NpcHandle h) const {
+        const size_t i = h.index();
+        return i < generation.size() && generation[i] == h.generation() ? i : kNoSlot;
+    }
+    const NameTable& getNameTable() const { return nameTable; }
+
+    NpcType getTypeId(size_t i) const { return type[i]; }
+    std::string_view getName(size_t i) const { return nameTable.get(nameIds[i]); }
+    int getX(size_t i) const { return x[i]; }
+    int getY(size_t i) const { return y[i]; }
+    int getMoveDistance(size_t i) const { return moveDistance[i]; }
+    int getKillDistance(size_t i) const { return killDistance[i]; }
+    bool isAlive(size_t i) const { return alive[i] != 0; }
+    void kill(size_t i);
+
+    const int* xData() const { return x.data(); }
+    const int* yData() const { return y.data(); }
+    const uint8_t* aliveData() const { return alive.data(); }
+    const NpcType* typeData() const { return type.data(); }
+    const uint32_t* generationData() const { return generation.data(); }
+    const int* moveDistanceData() const { return moveDistance.data(); }
+    const int* killDistanceData() const { return killDistance.data(); }
+
+    // Random draws are keyed by (seed, index, tick), so the outcome does not
+    // depend on which thread moves or fights which NPC.
+    void moveRandomly(size_t i);
+    void beginTick() { ++tick; }
+    // Moves NPCs [begin, end); disjoint ranges may run on different threads.
+    void moveRange(size_t begin, size_t end);
+    void moveAll();
+    bool isInRangeForKill(size_t attacker, size_t target) const;
+    FightResult fight(size_t attacker, size_t defender);
+
+    // Claims both NPCs for one fight; fails without side effects when
+    // either is already claimed.
+    bool tryClaim(size_t a, size_t b);
+    void release(size_t a, size_t b);
+
+    // Starts keeping an OccupancyGrid of cellSize blocks current through
+    // add, move, kill and assign; views read it instead of the columns.
+    void trackOccupancy(int cellSize);
+    const OccupancyGrid* getOccupancy() const { return occupancy.get(); }
+
+    // Spawns, moves and fights are published to `bus` when one is set and
+    // a subscriber wants them. Pass nullptr to stop publishing.
+    void setEventBus(EventBus* bus) { events = bus; }
+    EventBus* getEventBus() const { return events; }
+    std::shared_ptr<NPC> toNpc(size_t i) const;
+
+private:
+    void publishFight(size_t attacker, size_t defender, bool win) const;
+    size_t acquireSlot();
+    // Everything assign() does except naming: nameIds is sized, not filled.
+    void assignColumns(int mapX, int mapY, size_t count, const int* xs, const int* ys,
+                       const uint8_t* aliveFlags, const NpcType* types);
+
+    int mapSizeX, mapSizeY;
+    uint64_t seed;
+    uint64_t tick = 0;
+    std::vector<int> x, y;
+    std::vector<uint8_t> alive;
+    std::vector<NpcType> type;
+    std::vector<int> moveDistance, killDistance;
+    std::deque<std::atomic<uint8_t>> claims;
+    std::vector<uint32_t> generation;
+    // Dead slots ready for reuse, highest index first so pop_back() hands
+    // out the lowest. Refilled by a sweep when empty and kills are pending.
+    std::vector<uint32_t> freeSlots;
+    std::atomic<size_t> pendingDead{0};
+    std::unique_ptr<OccupancyGrid> occupancy;
+
+    std::vector<uint32_t> nameIds;
+    NameTable nameTable;
+    EventBus* events = nullptr;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "occupancy_grid.hpp"
+#include "world.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Immutable copy of the World columns as they stood at the end of one tick.
+// Names are not copied: look them up in the World once the simulation has
+// stopped.
+struct WorldFrame {
+    uint64_t tick = 0;
+    int mapSizeX = 0, mapSizeY = 0;
+    std::vector<int> x, y;
+    std::vector<uint8_t> alive;
+    std::vector<NpcType> type;
+    std::vector<uint32_t> generation;
+    // Frozen copy of the world's occupancy grid, when it tracks one.
+    std::unique_ptr<OccupancyGrid> occupancy;
+
+    size_t size() const { return x.size(); }
+    size_t aliveCount() const;
+};
+
+// Double-buffered publication of WorldFrames. The simulation thread owns
+// the World and calls publish() between ticks. Readers (renderers, savers,
+// analytics) call current() from any thread and keep the returned frame as
+// long as they like: nothing they hold is ever written again, and neither
+// side takes a lock.
+//
+// publish() fills the back buffer and swaps it to the front. When a reader
+// still pins the old front, a fresh buffer is allocated instead of waiting.
+class FrameBuffer {
+public:
+    void publish(const World& world);
+    std::shared_ptr<const WorldFrame> current() const { return std::atomic_load(&front); }
+
+    uint64_t getPublished() const { return published; }
+    // Publications that could not reuse the back buffer because a reader
+    // still held it.
+    uint64_t getAllocations() const { return allocations; }
+
+private:
+    std::shared_ptr<const WorldFrame> front;
+    std::shared_ptr<WorldFrame> back;
+    uint64_t published = 0;
+    uint64_t allocations = 0;
+};
@@ -1,154 +1,397 @@
 #include "include/npc_system.hpp"
+#include "include/spatial_grid.hpp"
+#include "include/world.hpp"
+#include "include/rng.hpp"
+#include "include/replay.hpp"
+#include "include/scenario.hpp"
+#include "include/scheduler.hpp"
+#include "include/battle.hpp"
+#include "include/checkpoint.hpp"
+#include "include/console_reporter.hpp"
+#include "include/event_bus.hpp"
+#include "include/fight_log.hpp"
+#include "include/map_view.hpp"
+#include "include/metrics.hpp"
+#include "include/snapshot.hpp"
+#include "include/thread_pool.hpp"
+#include "include/tiles.hpp"
+#include "include/timing_wheel.hpp"
+#include "include/world_frame.hpp"
 #include <thread>
 #include <mutex>
-#include <shared_mutex>
-#include <condition_variable>
-#include <queue>
 #include <chrono>
 #include <random>
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <algorithm>
 #include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <unistd.h>
 
-std::vector<std::shared_ptr<NPC>> npcs;
-std::shared_mutex npcsMutex;        
-std::mutex coutMutex;               
-
-struct BattleTask {
-    std::shared_ptr<NPC> attacker;
-    std::shared_ptr<NPC> target;
-};
-
-std::queue<BattleTask> battleQueue;
-std::mutex battleQueueMutex;
-std::condition_variable battleQueueCV;
-std::atomic<bool> gameRunning{true};
 const int MAP_SIZE_X = 100;
 const int MAP_SIZE_Y = 100;
 const int GAME_DURATION_SECONDS = 30;
 
-void printMap() {
-    std::vector<std::shared_ptr<NPC>> localNpcs;
-    {
-        std::shared_lock<std::shared_mutex> lock(npcsMutex);
-        localNpcs = npcs;
+World world(MAP_SIZE_X, MAP_SIZE_Y);
+std::mutex coutMutex;               
+
+BattleQueue battleQueue(1 << 16);
+std::atomic<bool> gameRunning{true};
+
+// Draws the occupancy grid frozen in the last published frame: no lock,
+// and never a half-moved tick.
+// Runs one of main's file operations. A failure is printed rather than
+// left to terminate the program; the caller then exits with status 1.
+template <typename Operation>
+bool reportErrors(Operation&& operation) {
+    try {
+        operation();
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
     }
+}
 
+void printMap(MapView& view, const FrameBuffer& frames, bool ansi) {
+    auto frame = frames.current();
+    if (!frame || !frame->occupancy) return;
+    std::string text = view.render(*frame->occupancy, ansi);
     std::lock_guard<std::mutex> lock(coutMutex);
-    std::cout << "\n=== MAP (" << MAP_SIZE_X << "x" << MAP_SIZE_Y << ") ===" << std::endl;
-    for (int y = 0; y < MAP_SIZE_Y; y += 10) { 
-        for (int x = 0; x < MAP_SIZE_X; x += 10) {
-            char c = '.';
-            for (const auto& npc : localNpcs) {
-                if (npc->isAlive() && npc->getX() / 10 == x / 10 && npc->getY() / 10 == y / 10) {
-                    if (npc->getType() == "Bear") c = 'B';
-                    else if (npc->getType() == "Duck") c = 'D';
-                    else if (npc->getType() == "Desman") c = 'S';
-                    break;
-                }
-            }
-            std::cout << c;
-        }
-        std::cout << std::endl;
-    }
-    std::cout << "=========================" << std::endl;
+    std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    std::cout.flush();
 }
 
-int main() {
-    auto textObserver = TextObserver::get();
-    auto fileObserver = FileObserver::get();
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> coordX(0, MAP_SIZE_X - 1);
-    std::uniform_int_distribution<> coordY(0, MAP_SIZE_Y - 1);
-    std::uniform_int_distribution<> npcType(0, 2);
-
-    for (int i = 0; i < 50; ++i) {
-        int x = coordX(gen);
-        int y = coordY(gen);
-        std::shared_ptr<NPC> npc;
-        int type = npcType(gen);
-        switch (type) {
-            case 0: npc = std::make_shared<Bear>("Bear" + std::to_string(i), x, y); break;
-            case 1: npc = std::make_shared<Duck>("Duck" + std::to_string(i), x, y); break;
-            case 2: npc = std::make_shared<Desman>("Desman" + std::to_string(i), x, y); break;
-        }
-        npc->subscribe(textObserver);
-        npc->subscribe(fileObserver);
-        {
-            std::lock_guard<std::shared_mutex> lock(npcsMutex);
-            npcs.push_back(npc);
+int main(int argc, char** argv) {
+    uint64_t seed = (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+    long tickMs = 500;
+    size_t threads = std::thread::hardware_concurrency();
+    size_t battleWorkerCount = 0;
+    Backpressure backpressure = Backpressure::Coalesce;
+    std::string fightLogPath = "fight_log.bin";
+    std::string loadSnapshotPath;
+    std::string saveSnapshotPath;
+    std::string recordPath;
+    std::string checkpointPath;
+    std::string loadCheckpointPath;
+    std::string loadTextPath;
+    uint64_t checkpointEvery = 100;
+    std::string replayPath;
+    bool headless = false;
+    bool fightLogRequested = false;
+    ScenarioSpec scenario;
+    scenario.count = 50;
+    std::string densityImagePath;
+    int mapSize = MAP_SIZE_X;
+    uint64_t maxTicks = 1000;
+    std::string metricsPath;
+    MetricsFormat metricsFormat = MetricsFormat::Json;
+    long metricsIntervalMs = 1000;
+    int mapCellSize = 10;
+    int tileSize = 0;
+    bool verbose = false;
+    size_t topKillers = 0;
+    bool sleepTiles = true;
+    std::vector<std::pair<NpcType, UpdateRate>> speciesRates;
+    int zoom = 1;
+    bool ansi = isatty(STDOUT_FILENO) != 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--tick-ms") == 0 && i + 1 < argc) {
+            tickMs = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--battle-workers") == 0 && i + 1 < argc) {
+            battleWorkerCount = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--fight-log") == 0 && i + 1 < argc) {
+            fightLogPath = argv[++i];
+            fightLogRequested = true;
+        } else if (std::strcmp(argv[i], "--load-snapshot") == 0 && i + 1 < argc) {
+            loadSnapshotPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--save-snapshot") == 0 && i + 1 < argc) {
+            saveSnapshotPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpointPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+            checkpointEvery = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--load-text") == 0 && i + 1 < argc) {
+            loadTextPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--load-checkpoint") == 0 && i + 1 < argc) {
+            loadCheckpointPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--backpressure") == 0 && i + 1 < argc) {
+            backpressure = std::strcmp(argv[++i], "drop") == 0 ? Backpressure::Drop : Backpressure::Coalesce;
+        } else if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (std::strcmp(argv[i], "--npcs") == 0 && i + 1 < argc) {
+            scenario.count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--ratios") == 0 && i + 1 < argc) {
+            // One weight per species in NpcType order, e.g. --ratios 1:4:2
+            const char* text = argv[++i];
+            for (size_t t = 0; t < kSpeciesCount; ++t) {
+                char* rest = nullptr;
+                scenario.ratios[t] = static_cast<uint32_t>(std::strtoul(text, &rest, 10));
+                text = *rest == ':' ? rest + 1 : rest;
+            }
+        } else if (std::strcmp(argv[i], "--distribution") == 0 && i + 1 < argc) {
+            // uniform, clustered, or the path of a PGM density image
+            const char* mode = argv[++i];
+            if (std::strcmp(mode, "clustered") == 0) {
+                scenario.distribution = Distribution::Clustered;
+            } else if (std::strcmp(mode, "uniform") == 0) {
+                scenario.distribution = Distribution::Uniform;
+            } else {
+                scenario.distribution = Distribution::Density;
+                densityImagePath = mode;
+            }
+        } else if (std::strcmp(argv[i], "--clusters") == 0 && i + 1 < argc) {
+            scenario.clusters = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--cluster-radius") == 0 && i + 1 < argc) {
+            scenario.clusterRadius = std::max(0, static_cast<int>(std::strtol(argv[++i], nullptr, 10)));
+        } else if (std::strcmp(argv[i], "--map-size") == 0 && i + 1 < argc) {
+            mapSize = std::max(1, static_cast<int>(std::strtol(argv[++i], nullptr, 10)));
+        } else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--map-cell") == 0 && i + 1 < argc) {
+            mapCellSize = std::max(1, static_cast<int>(std::strtol(argv[++i], nullptr, 10)));
+        } else if (std::strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc) {
+            tileSize = std::max(0, static_cast<int>(std::strtol(argv[++i], nullptr, 10)));
+        } else if (std::strcmp(argv[i], "--no-sleep") == 0) {
+            sleepTiles = false;
+        } else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            // species=move[:attack], e.g. --rate bear=4:2
+            const std::string spec = argv[++i];
+            const size_t eq = spec.find('=');
+            for (size_t t = 0; t < kSpeciesCount && eq != std::string::npos; ++t) {
+                const NpcType type = static_cast<NpcType>(t);
+                if (strcasecmp(spec.substr(0, eq).c_str(), typeName(type)) != 0) continue;
+                char* rest = nullptr;
+                UpdateRate rate;
+                rate.moveEvery = static_cast<uint32_t>(std::strtoul(spec.c_str() + eq + 1, &rest, 10));
+                rate.attackEvery = *rest == ':' ? static_cast<uint32_t>(std::strtoul(rest + 1, nullptr, 10)) : rate.moveEvery;
+                speciesRates.emplace_back(type, rate);
+            }
+        } else if (std::strcmp(argv[i], "--zoom") == 0 && i + 1 < argc) {
+            zoom = std::max(1, static_cast<int>(std::strtol(argv[++i], nullptr, 10)));
+        } else if (std::strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (std::strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            topKillers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--no-ansi") == 0) {
+            ansi = false;
+        } else if (std::strcmp(argv[i], "--metrics-out") == 0 && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-format") == 0 && i + 1 < argc) {
+            metricsFormat = std::strcmp(argv[++i], "prometheus") == 0 ? MetricsFormat::Prometheus : MetricsFormat::Json;
+        } else if (std::strcmp(argv[i], "--metrics-interval-ms") == 0 && i + 1 < argc) {
+            metricsIntervalMs = std::max(1L, std::strtol(argv[++i], nullptr, 10));
         }
     }
 
-    std::cout << "Starting game with 50 NPCs" << std::endl;
+    // Replays run headless at full speed and only redo moves and the
+    // recorded fights, so the same workload can be timed again and again.
+    if (!replayPath.empty()) {
+        ThreadPool pool(threads);
+        auto start = std::chrono::steady_clock::now();
+        ReplayStats stats;
+        if (!reportErrors([&]() { stats = replaySession(world, replayPath, pool); })) return 1;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Replayed " << replayPath << ": " << world.size() << " NPCs, seed " << world.getSeed() << "\n"
+                  << "Ticks: " << stats.ticks << " in " << seconds << " s\n"
+                  << "Ticks/sec: " << (seconds > 0 ? stats.ticks / seconds : 0.0) << "\n"
+                  << "Fights: " << stats.fights << ", mismatches: " << stats.mismatches
+                  << ", survivors: " << world.aliveCount() << std::endl;
+        return stats.mismatches == 0 ? 0 : 1;
+    }
 
-    auto movementThread = [&]() {
-        while (gameRunning.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    setSimulationSeed(seed);
+    world.setSeed(seed);
 
-            {
-                std::lock_guard<std::shared_mutex> lock(npcsMutex);
-                for (auto& npc : npcs) {
-                    if (npc->isAlive()) {
-                        npc->moveRandomly(MAP_SIZE_X, MAP_SIZE_Y);
-                    }
-                }
+    if (!loadTextPath.empty()) {
+        world.setMapSize(mapSize, mapSize);
+        ThreadPool loaderPool(threads);
+        if (!reportErrors([&]() { loadTextFile(world, loadTextPath, loaderPool); })) return 1;
+    } else if (!loadCheckpointPath.empty()) {
+        if (!reportErrors([&]() { loadCheckpoint(world, loadCheckpointPath); })) return 1;
+        world.setSeed(seed);
+    } else if (!loadSnapshotPath.empty()) {
+        if (!reportErrors([&]() { loadSnapshot(world, loadSnapshotPath); })) return 1;
+        world.setSeed(seed);
+    } else {
+        world.setMapSize(mapSize, mapSize);
+        scenario.seed = seed;
+        ThreadPool spawnPool(threads);
+        const bool spawned = reportErrors([&]() {
+            if (!densityImagePath.empty()) {
+                scenario.density = std::make_shared<DensityMap>(loadDensityMap(densityImagePath));
             }
+            generateScenario(world, scenario, spawnPool);
+        });
+        if (!spawned) return 1;
+    }
 
-            std::vector<std::shared_ptr<NPC>> localNpcs;
-            {
-                std::shared_lock<std::shared_mutex> lock(npcsMutex);
-                localNpcs = npcs;
-                for (size_t i = 0; i < localNpcs.size(); ++i) {
-                    if (!localNpcs[i]->isAlive()) continue;
-                    for (size_t j = i + 1; j < localNpcs.size(); ++j) {
-                        if (!localNpcs[j]->isAlive()) continue;
-                        if (localNpcs[i]->isInRangeForKill(*localNpcs[j])) {
-                            BattleTask task{localNpcs[i], localNpcs[j]};
-                            {
-                                std::lock_guard<std::mutex> qLock(battleQueueMutex);
-                                battleQueue.push(task);
-                            }
-                            battleQueueCV.notify_one();
-                        }
-                    }
-                }
-            }
+    // Headless runs measure the simulation alone: no event bus, no console
+    // output while ticking and no fight log unless one is asked for.
+    // Otherwise kills reach the console as one summary per tick.
+    ConsoleReporter reporter(world, std::cout, coutMutex);
+    reporter.setVerbose(verbose);
+    reporter.setTopN(topKillers);
+    EventBus events;
+    if (!headless) {
+        events.subscribe(ConsoleReporter::kFilter, [&reporter](uint64_t tick, const std::vector<WorldEvent>& batch) {
+            reporter.report(tick, batch);
+        });
+        world.setEventBus(&events);
+    }
+
+    if (!headless) std::cout << "Starting game with " << world.size() << " NPCs (seed " << seed << ")" << std::endl;
+
+    ThreadPool pool(threads);
+    TickScheduler scheduler(pool, std::chrono::milliseconds(headless ? 0 : tickMs));
+    SpatialGrid grid;
+    // With --tile-size the map is split into tiles that move, migrate and
+    // detect contacts independently; otherwise it is one shared region.
+    std::unique_ptr<TileDecomposition> tiles;
+    if (tileSize > 0) {
+        tiles = std::make_unique<TileDecomposition>(world.getMapSizeX(), world.getMapSizeY(), tileSize);
+        tiles->setSleeping(sleepTiles);
+        tiles->assign(world);
+    }
+    // With --rate each NPC moves and attacks on its species' own cadence;
+    // otherwise everyone updates every tick.
+    std::unique_ptr<RateScheduler> rates;
+    if (!speciesRates.empty()) {
+        rates = std::make_unique<RateScheduler>(world);
+        for (const auto& [type, rate] : speciesRates) rates->setRate(type, rate);
+        rates->scheduleAll();
+    }
+    BattleWorkers battleWorkers(world, battleQueue, battleWorkerCount ? battleWorkerCount : pool.size());
+    AsyncFightLog fightLog;
+    if (!headless || fightLogRequested) {
+        if (!fightLog.open(fightLogPath, world)) {
+            std::cerr << "Cannot open fight log: " << fightLogPath << std::endl;
+            return 1;
+        }
+        battleWorkers.setFightLog(&fightLog);
+    }
+    ReplayRecorder recorder;
+    if (!recordPath.empty()) {
+        if (!reportErrors([&]() { recorder.open(recordPath, world, rates.get()); })) return 1;
+        battleWorkers.setRecorder(&recorder);
+    }
+    ContactCoalescer coalescer(battleQueue, backpressure);
+    FrameBuffer frames;
+    // Checkpoints reuse the published frames; the writer thread diffs and
+    // writes them, so a checkpoint tick costs the simulation no more than
+    // any other.
+    Checkpointer checkpointer;
+    if (!checkpointPath.empty() && !reportErrors([&]() { checkpointer.open(checkpointPath, world); })) return 1;
+    auto checkpointDue = [&]() { return checkpointer.isOpen() && world.getTick() % checkpointEvery == 0; };
+    // Slots reused since the last delta need a new base, written here on
+    // the simulation thread.
+    auto checkpoint = [&]() {
+        if (checkpointer.needsBase()) {
+            checkpointer.rebase(world);
+        } else {
+            checkpointer.submit(frames.current());
         }
     };
+    uint64_t contactCount = 0;
+    MetricsDumper metricsDumper;
+    if (!metricsPath.empty()) {
+        if (!metricsDumper.start(metricsPath, metricsFormat, std::chrono::milliseconds(metricsIntervalMs))) {
+            std::cerr << "Cannot write metrics: " << metricsPath << std::endl;
+            return 1;
+        }
+    }
+
+    scheduler.setPhase(TickPhase::Move, [&](uint64_t) {
+        if (rates) {
+            rates->tick(pool);
+        } else if (tiles) {
+            world.beginTick();
+            tiles->move(world, pool);
+        } else {
+            world.beginTick();
+            pool.parallelFor(0, world.size(), 4096, [](size_t begin, size_t end) {
+                world.moveRange(begin, end);
+            });
+        }
+        if (tiles) tiles->migrate(world, pool);
+    });
 
-    auto battleThread = [&]() {
-        while (gameRunning.load()) {
-            std::unique_lock<std::mutex> lock(battleQueueMutex);
-            battleQueueCV.wait(lock, [] { return !battleQueue.empty() || !gameRunning.load(); });
+    scheduler.setPhase(TickPhase::DetectContacts, [&](uint64_t) {
+        auto contacts = tiles ? tiles->findContacts(world, pool) : grid.findContacts(world, pool);
+        if (rates) rates->filterContacts(contacts);
+        contactCount += contacts.size();
+        coalescer.submit(world, contacts);
+    });
 
-            if (!gameRunning.load() && battleQueue.empty()) break;
+    scheduler.setPhase(TickPhase::ResolveFights, [&](uint64_t) {
+        battleWorkers.drain(pool);
+    });
 
-            if (!battleQueue.empty()) {
-                BattleTask task = battleQueue.front();
-                battleQueue.pop();
-                lock.unlock();
+    scheduler.setPhase(TickPhase::Notify, [&](uint64_t) {
+        recorder.endTick(world.getTick());
+        if (headless) {
+            if (checkpointDue()) {
+                frames.publish(world);
+                checkpoint();
+            }
+            return;
+        }
+        events.flush(world.getTick());
+        frames.publish(world);
+        if (checkpointDue()) checkpoint();
+    });
 
-                if (!task.attacker || !task.target || !task.attacker->isAlive() || !task.target->isAlive()) {
-                    continue;
-                }
+    if (headless) {
+        auto start = std::chrono::steady_clock::now();
+        scheduler.run(gameRunning, maxTicks);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fightLog.close();
+        metricsDumper.stop();
+        checkpointer.close();
+        if (checkpointer.hasFailed()) {
+            std::cerr << "Checkpoint write failed: " << checkpointPath << std::endl;
+            return 1;
+        }
+        if (fightLog.hasFailed()) {
+            std::cerr << "Fight log write failed: " << fightLogPath << std::endl;
+            return 1;
+        }
 
-                BattleVisitor visitor(task.attacker);
-                task.target->accept(visitor);
+        if (!saveSnapshotPath.empty() && !reportErrors([&]() { saveSnapshot(world, saveSnapshotPath); })) return 1;
 
-                if (visitor.wasKill()) {
-                    std::lock_guard<std::mutex> lock(coutMutex);
-                    std::cout << "[BATTLE] " << visitor.getKiller() << " killed " << visitor.getVictim() << std::endl;
-                }
-            }
+        const double ticks = static_cast<double>(scheduler.getTick());
+        std::cout << "NPCs: " << world.size() << " on " << world.getMapSizeX() << "x" << world.getMapSizeY()
+                  << ", threads: " << pool.size() << ", seed: " << seed << "\n"
+                  << "Ticks: " << scheduler.getTick() << " in " << seconds << " s\n"
+                  << "Ticks/sec: " << (seconds > 0 ? ticks / seconds : 0.0) << "\n"
+                  << "Contacts: " << contactCount
+                  << ", contacts/sec: " << (seconds > 0 ? contactCount / seconds : 0.0) << "\n"
+                  << "Fights: " << battleWorkers.getFights()
+                  << ", survivors: " << world.aliveCount() << std::endl;
+        if (tiles) {
+            std::cout << "Tiles: " << tiles->tileCount() << " of " << tiles->getTileSize()
+                      << ", migrations: " << tiles->getMigrations()
+                      << ", active: " << tiles->getActiveFraction() * 100.0 << "%" << std::endl;
         }
-    };
+        return 0;
+    }
+
+    world.trackOccupancy(mapCellSize);
+    MapView view(*world.getOccupancy(), zoom);
+    frames.publish(world);
 
-    std::thread moveThread(movementThread);
-    std::thread battleTh(battleThread);
+    std::thread simulationThread([&]() { scheduler.run(gameRunning); });
 
     auto start = std::chrono::steady_clock::now();
     while (true) {
@@ -160,21 +403,32 @@ int main() {
             break;
         }
 
-        printMap();
+        printMap(view, frames, ansi);
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 
-    battleQueueCV.notify_all();
-    if (moveThread.joinable()) moveThread.join();
-    if (battleTh.joinable()) battleTh.join();
+    if (simulationThread.joinable()) simulationThread.join();
+    events.stop();
+    world.setEventBus(nullptr);
+    if (ansi) std::cout << "\x1b[r" << std::flush;
+    fightLog.close();
+    metricsDumper.stop();
+    checkpointer.close();
+    if (checkpointer.hasFailed()) {
+        std::cerr << "Checkpoint write failed: " << checkpointPath << std::endl;
+        return 1;
+    }
+    if (fightLog.hasFailed()) {
+        std::cerr << "Fight log write failed: " << fightLogPath << std::endl;
+        return 1;
+    }
 
-    std::vector<std::shared_ptr<NPC>> survivors;
-    {
-        std::shared_lock<std::shared_mutex> lock(npcsMutex);
-        for (const auto& npc : npcs) {
-            if (npc->isAlive()) {
-                survivors.push_back(npc);
-            }
+    if (!saveSnapshotPath.empty() && !reportErrors([&]() { saveSnapshot(world, saveSnapshotPath); })) return 1;
+
+    std::vector<NpcRef> survivors;
+    for (size_t i = 0; i < world.size(); ++i) {
+        if (world.isAlive(i)) {
+            survivors.push_back(world[i]);
         }
     }
 
@@ -182,8 +436,15 @@ int main() {
         std::lock_guard<std::mutex> lock(coutMutex);
         std::cout << "\n=== GAME OVER ===" << std::endl;
         std::cout << "Survivors: " << survivors.size() << std::endl;
+        std::cout << "Fights: " << battleWorkers.getFights()
+                  << ", claim failures: " << battleWorkers.getClaimFailures()
+                  << ", queue depth: " << battleQueue.depth()
+                  << ", queued: " << coalescer.getQueued()
+                  << ", filtered: " << coalescer.getImpossible()
+                  << ", coalesced: " << coalescer.getCoalesced()
+                  << ", dropped: " << coalescer.getDropped() << std::endl;
         for (const auto& npc : survivors) {
-            std::cout << "[" << npc->getType() << "] " << npc->getName() << " @ (" << npc->getX() << ", " << npc->getY() << ")\n";
+            std::cout << "[" << npc.getType() << "] " << npc.getName() << " @ (" << npc.getX() << ", " << npc.getY() << ")\n";
         }
     }
 
@@ -0,0 +1,166 @@
+#include "../include/battle.hpp"
+#include "../include/metrics.hpp"
+#include "../include/replay.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+BattleQueue::BattleQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    mask = size - 1;
+    cells = std::make_unique<Cell[]>(size);
+    for (size_t i = 0; i < size; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool BattleQueue::tryPush(const BattleTask& task) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->task = task;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool BattleQueue::tryPop(BattleTask& task) {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    task = cell->task;
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
+
+size_t BattleQueue::depth() const {
+    size_t head = dequeuePos.load(std::memory_order_relaxed);
+    size_t tail = enqueuePos.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
+
+BattleWorkers::BattleWorkers(World& world, BattleQueue& queue, size_t workers)
+    : world(world), queue(queue), workers(workers == 0 ? 1 : workers) {}
+
+void BattleWorkers::drain(ThreadPool& pool) {
+    pool.parallelFor(0, workers, 1, [&](size_t begin, size_t end) {
+        for (size_t w = begin; w < end; ++w) run();
+    });
+}
+
+void BattleWorkers::run() {
+    BattleTask task;
+    while (queue.tryPop(task)) {
+        const size_t attacker = world.resolve(task.attacker);
+        const size_t target = world.resolve(task.target);
+        if (attacker == World::kNoSlot || target == World::kNoSlot) {
+            stale.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (!world.tryClaim(attacker, target)) {
+            claimFailures.fetch_add(1, std::memory_order_relaxed);
+            countEvent(Counter::ClaimFailures);
+            while (!queue.tryPush(task)) std::this_thread::yield();
+            continue;
+        }
+
+        // Alive flags and positions of claimed NPCs are only touched by
+        // this worker until they are released.
+        if (world.isInRangeForKill(attacker, target)) {
+            FightResult result = world.fight(attacker, target);
+            if (recorder) recorder->record(attacker, target, result);
+            if (result != FightResult::NoFight) {
+                fights.fetch_add(1, std::memory_order_relaxed);
+                countEvent(Counter::Fights);
+                if (fightLog) {
+                    FightRecord record{};
+                    record.tick = world.getTick();
+                    record.attacker = static_cast<uint32_t>(attacker);
+                    record.defender = static_cast<uint32_t>(target);
+                    record.attackerGeneration = task.attacker.generation();
+                    record.defenderGeneration = task.target.generation();
+                    record.attackerX = world.getX(attacker);
+                    record.attackerY = world.getY(attacker);
+                    record.defenderX = world.getX(target);
+                    record.defenderY = world.getY(target);
+                    record.attackerType = static_cast<uint8_t>(world.getTypeId(attacker));
+                    record.defenderType = static_cast<uint8_t>(world.getTypeId(target));
+                    record.win = result == FightResult::Won;
+                    fightLog->append(record);
+                }
+            }
+            if (result == FightResult::Won) {
+                kills.fetch_add(1, std::memory_order_relaxed);
+                countEvent(Counter::Kills);
+            }
+        }
+        world.release(attacker, target);
+    }
+}
+
+ContactCoalescer::ContactCoalescer(BattleQueue& queue, Backpressure policy)
+    : queue(queue), policy(policy) {}
+
+void ContactCoalescer::submit(const World& world, const std::vector<std::pair<size_t, size_t>>& contacts) {
+    scratch.clear();
+    scratch.insert(scratch.end(), deferred.begin(), deferred.end());
+    for (const auto& [attacker, target] : contacts) {
+        scratch.push_back(BattleTask{world.handle(attacker), world.handle(target)});
+    }
+    deferred.clear();
+
+    std::sort(scratch.begin(), scratch.end(), [](const BattleTask& a, const BattleTask& b) {
+        return a.attacker != b.attacker ? a.attacker < b.attacker : a.target < b.target;
+    });
+    auto last = std::unique(scratch.begin(), scratch.end(), [](const BattleTask& a, const BattleTask& b) {
+        return a.attacker == b.attacker && a.target == b.target;
+    });
+    duplicates += static_cast<uint64_t>(scratch.end() - last);
+    scratch.erase(last, scratch.end());
+
+    for (const BattleTask& task : scratch) {
+        const NpcHandle attackerHandle = task.attacker;
+        const NpcHandle targetHandle = task.target;
+        const size_t attacker = world.resolve(attackerHandle);
+        const size_t target = world.resolve(targetHandle);
+        if (attacker == World::kNoSlot || target == World::kNoSlot || !world.isAlive(attacker) || !world.isAlive(target) ||
+            !canAttack(world.getTypeId(attacker), world.getTypeId(target))) {
+            ++impossible;
+            continue;
+        }
+
+        if (queue.tryPush(task)) {
+            ++queued;
+            countEvent(Counter::TasksQueued);
+        } else if (policy == Backpressure::Coalesce && deferred.size() < queue.capacity()) {
+            deferred.push_back(task);
+            ++coalesced;
+            countEvent(Counter::TasksCoalesced);
+        } else {
+            ++dropped;
+            countEvent(Counter::TasksDropped);
+        }
+    }
+}
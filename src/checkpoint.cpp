@@ -0,0 +1,196 @@
+#include "../include/checkpoint.hpp"
+#include "../include/snapshot.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const char kMagic[8] = {'N', 'P', 'C', 'D', 'E', 'L', 'T', '1'};
+
+std::string deltaPath(const std::string& path) {
+    return path + ".delta";
+}
+
+uint64_t entriesChecksum(const std::vector<DeltaEntry>& entries) {
+    return snapshotChecksum(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(DeltaEntry));
+}
+
+}
+
+void Checkpointer::open(const std::string& target, const World& world) {
+    close();
+    path = target;
+    baseNeeded.store(false, std::memory_order_relaxed);
+    failed.store(false, std::memory_order_relaxed);
+    saveSnapshot(world, path);
+
+    FrameBuffer base;
+    base.publish(world);
+    last = base.current();
+
+    file = std::fopen(deltaPath(path).c_str(), "wb");
+    if (!file) throw std::runtime_error("Cannot open checkpoint log for writing: " + deltaPath(path));
+    if (std::fwrite(kMagic, 1, sizeof(kMagic), file) != sizeof(kMagic) || std::fflush(file) != 0) {
+        std::fclose(file);
+        file = nullptr;
+        throw std::runtime_error("Cannot write checkpoint log: " + deltaPath(path));
+    }
+
+    stopping = false;
+    writer = std::thread([this]() { writerLoop(); });
+}
+
+void Checkpointer::close() {
+    if (!file) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (writer.joinable()) writer.join();
+    std::fclose(file);
+    file = nullptr;
+    last.reset();
+}
+
+void Checkpointer::rebase(const World& world) {
+    try {
+        open(path, world);
+    } catch (const std::runtime_error&) {
+        close();
+        failed.store(true, std::memory_order_relaxed);
+    }
+}
+
+void Checkpointer::submit(std::shared_ptr<const WorldFrame> frame) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (pending) skipped.fetch_add(1, std::memory_order_relaxed);
+        pending = std::move(frame);
+    }
+    wake.notify_one();
+}
+
+void Checkpointer::flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    idle.wait(lock, [&]() { return !pending && !busy; });
+}
+
+void Checkpointer::writerLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        wake.wait(lock, [&]() { return pending || stopping; });
+        if (!pending) break;
+
+        std::shared_ptr<const WorldFrame> frame = std::move(pending);
+        pending.reset();
+        busy = true;
+        lock.unlock();
+
+        if (writeDelta(*frame)) last = std::move(frame);
+
+        lock.lock();
+        busy = false;
+        if (!pending) idle.notify_all();
+    }
+}
+
+bool Checkpointer::writeDelta(const WorldFrame& frame) {
+    if (baseNeeded.load(std::memory_order_relaxed) || failed.load(std::memory_order_relaxed)) return false;
+    const WorldFrame& prev = *last;
+    if (frame.size() != prev.size() || frame.generation != prev.generation) {
+        baseNeeded.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    const size_t count = frame.size();
+    scratch.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (frame.x[i] == prev.x[i] && frame.y[i] == prev.y[i] && frame.alive[i] == prev.alive[i] &&
+            frame.type[i] == prev.type[i]) {
+            continue;
+        }
+        DeltaEntry entry{};
+        entry.index = static_cast<uint32_t>(i);
+        entry.x = frame.x[i];
+        entry.y = frame.y[i];
+        entry.alive = frame.alive[i];
+        entry.type = static_cast<uint8_t>(frame.type[i]);
+        scratch.push_back(entry);
+    }
+
+    DeltaHeader header{};
+    header.tick = frame.tick;
+    header.count = scratch.size();
+    header.checksum = entriesChecksum(scratch);
+    // A short write leaves a torn delta that the loader stops at; nothing
+    // is appended after it.
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1 ||
+        std::fwrite(scratch.data(), sizeof(DeltaEntry), scratch.size(), file) != scratch.size() ||
+        std::fflush(file) != 0) {
+        failed.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    written.fetch_add(1, std::memory_order_relaxed);
+    entries.fetch_add(scratch.size(), std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t loadCheckpoint(World& world, const std::string& path) {
+    loadSnapshot(world, path);
+
+    std::FILE* log = std::fopen(deltaPath(path).c_str(), "rb");
+    if (!log) throw std::runtime_error("Cannot open checkpoint log: " + deltaPath(path));
+    char magic[sizeof(kMagic)];
+    if (std::fread(magic, 1, sizeof(magic), log) != sizeof(magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        std::fclose(log);
+        throw std::runtime_error("Not a checkpoint log: " + deltaPath(path));
+    }
+
+    const size_t count = world.size();
+    std::vector<int> xs(world.xData(), world.xData() + count);
+    std::vector<int> ys(world.yData(), world.yData() + count);
+    std::vector<uint8_t> alive(world.aliveData(), world.aliveData() + count);
+    std::vector<NpcType> types(world.typeData(), world.typeData() + count);
+    uint64_t tick = world.getTick();
+
+    std::fseek(log, 0, SEEK_END);
+    const long logSize = std::ftell(log);
+    std::fseek(log, sizeof(kMagic), SEEK_SET);
+
+    DeltaHeader header;
+    std::vector<DeltaEntry> entries;
+    while (std::fread(&header, sizeof(header), 1, log) == 1) {
+        // A torn header may claim any count; never size past the bytes left.
+        const uint64_t remaining = static_cast<uint64_t>(logSize - std::ftell(log));
+        if (header.count > remaining / sizeof(DeltaEntry)) break;
+        entries.resize(static_cast<size_t>(header.count));
+        if (std::fread(entries.data(), sizeof(DeltaEntry), entries.size(), log) != entries.size() ||
+            entriesChecksum(entries) != header.checksum) {
+            break;
+        }
+        for (const DeltaEntry& entry : entries) {
+            if (entry.index >= count || entry.type >= kSpeciesCount) {
+                std::fclose(log);
+                throw std::runtime_error("Corrupt checkpoint delta in " + deltaPath(path));
+            }
+            xs[entry.index] = entry.x;
+            ys[entry.index] = entry.y;
+            alive[entry.index] = entry.alive;
+            types[entry.index] = static_cast<NpcType>(entry.type);
+        }
+        tick = header.tick;
+    }
+    std::fclose(log);
+
+    std::vector<std::string> names(count);
+    for (size_t i = 0; i < count; ++i) names[i] = std::string(world.getName(i));
+    const uint64_t seed = world.getSeed();
+    world.assign(world.getMapSizeX(), world.getMapSizeY(), count, xs.data(), ys.data(), alive.data(), types.data(),
+                 std::move(names));
+    world.setSeed(seed);
+    world.setTick(tick);
+    return tick;
+}
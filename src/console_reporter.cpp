@@ -0,0 +1,90 @@
+#include "../include/console_reporter.hpp"
+#include <algorithm>
+#include <utility>
+
+ConsoleReporter::ConsoleReporter(const World& world, std::ostream& os, std::mutex& outMutex)
+    : os(os), outMutex(outMutex) {
+    for (size_t i = 0; i < world.size(); ++i) {
+        if (world.isAlive(i)) ++alive[static_cast<size_t>(world.getTypeId(i))];
+    }
+}
+
+void ConsoleReporter::report(uint64_t tick, const std::vector<WorldEvent>& events) {
+    buffer.clear();
+    format(tick, events, buffer);
+    if (buffer.empty()) return;
+    std::lock_guard<std::mutex> lock(outMutex);
+    os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    os.flush();
+}
+
+void ConsoleReporter::format(uint64_t tick, const std::vector<WorldEvent>& events, std::string& out) {
+    uint64_t pairs[kSpeciesCount][kSpeciesCount] = {};
+    uint64_t kills = 0;
+    std::vector<std::pair<uint32_t, std::string_view>> killers;
+
+    for (const WorldEvent& event : events) {
+        if (event.type == EventType::Spawn) {
+            ++alive[static_cast<size_t>(event.npcType)];
+            continue;
+        }
+        if (event.type != EventType::Kill) continue;
+        ++kills;
+        ++pairs[static_cast<size_t>(event.npcType)][static_cast<size_t>(event.otherType)];
+        --alive[static_cast<size_t>(event.otherType)];
+        if (topN) killers.emplace_back(event.npc, event.npcName);
+        if (verbose) {
+            out += "[BATTLE] ";
+            out += event.npcName;
+            out += " killed ";
+            out += event.otherName;
+            out += '\n';
+        }
+    }
+    if (kills == 0) return;
+
+    out += "[tick " + std::to_string(tick) + "] " + std::to_string(kills) + (kills == 1 ? " kill:" : " kills:");
+    const char* separator = " ";
+    for (size_t a = 0; a < kSpeciesCount; ++a) {
+        for (size_t d = 0; d < kSpeciesCount; ++d) {
+            if (!pairs[a][d]) continue;
+            out += separator;
+            out += typeName(static_cast<NpcType>(a));
+            out += '>';
+            out += typeName(static_cast<NpcType>(d));
+            out += ' ' + std::to_string(pairs[a][d]);
+            separator = ", ";
+        }
+    }
+    out += " | alive:";
+    separator = " ";
+    for (size_t t = 0; t < kSpeciesCount; ++t) {
+        out += separator;
+        out += typeName(static_cast<NpcType>(t));
+        out += ' ' + std::to_string(alive[t]);
+        separator = ", ";
+    }
+    out += '\n';
+
+    if (!killers.empty()) {
+        // Kills per attacker, most first; ties go to the lower index.
+        std::sort(killers.begin(), killers.end());
+        std::vector<std::pair<uint64_t, size_t>> ranked;
+        for (size_t k = 0; k < killers.size();) {
+            size_t end = k;
+            while (end < killers.size() && killers[end].first == killers[k].first) ++end;
+            ranked.emplace_back(end - k, k);
+            k = end;
+        }
+        std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        out += "  top:";
+        separator = " ";
+        for (size_t r = 0; r < std::min(topN, ranked.size()); ++r) {
+            out += separator;
+            out += killers[ranked[r].second].second;
+            out += ' ' + std::to_string(ranked[r].first);
+            separator = ", ";
+        }
+        out += '\n';
+    }
+}
@@ -0,0 +1,111 @@
+#include "../include/event_bus.hpp"
+#include "../include/metrics.hpp"
+#include <functional>
+#include <string>
+
+EventBus::~EventBus() {
+    stop();
+}
+
+void EventBus::subscribe(EventMask filter, Handler handler) {
+    auto subscriber = std::make_unique<Subscriber>();
+    subscriber->filter = filter;
+    subscriber->handler = std::move(handler);
+    Subscriber& s = *subscriber;
+    s.thread = std::thread([&s]() { run(s); });
+    subscribers.push_back(std::move(subscriber));
+    wanted.fetch_or(filter, std::memory_order_relaxed);
+}
+
+EventBus::Shard& EventBus::localShard() {
+    thread_local const size_t shard = std::hash<std::thread::id>()(std::this_thread::get_id()) % kShards;
+    return shards[shard];
+}
+
+void EventBus::publish(const WorldEvent& event) {
+    if (!wants(event.type)) return;
+    Shard& shard = localShard();
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.events.push_back(event);
+    published.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EventBus::flush(uint64_t tick) {
+    auto events = std::make_shared<std::vector<WorldEvent>>();
+    EventMask present = 0;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        for (const WorldEvent& event : shard.events) present |= eventBit(event.type);
+        events->insert(events->end(), shard.events.begin(), shard.events.end());
+        shard.events.clear();
+    }
+    if (events->empty()) return;
+
+    Batch batch = std::move(events);
+    for (auto& subscriber : subscribers) {
+        if ((subscriber->filter & present) == 0) continue;
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mtx);
+            subscriber->queue.emplace_back(tick, batch);
+        }
+        subscriber->wake.notify_one();
+    }
+    ++batches;
+}
+
+void EventBus::drain() {
+    for (auto& subscriber : subscribers) {
+        std::unique_lock<std::mutex> lock(subscriber->mtx);
+        subscriber->idle.wait(lock, [&]() { return subscriber->queue.empty() && !subscriber->busy; });
+    }
+}
+
+void EventBus::stop() {
+    for (auto& subscriber : subscribers) {
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mtx);
+            subscriber->stopping = true;
+        }
+        subscriber->wake.notify_one();
+    }
+    for (auto& subscriber : subscribers) {
+        if (subscriber->thread.joinable()) subscriber->thread.join();
+    }
+}
+
+void EventBus::run(Subscriber& s) {
+    std::vector<WorldEvent> mine;
+    std::unique_lock<std::mutex> lock(s.mtx);
+    while (true) {
+        s.wake.wait(lock, [&]() { return !s.queue.empty() || s.stopping; });
+        if (s.queue.empty()) break;
+
+        auto [tick, batch] = std::move(s.queue.front());
+        s.queue.pop_front();
+        s.busy = true;
+        lock.unlock();
+
+        mine.clear();
+        for (const WorldEvent& event : *batch) {
+            if (s.filter & eventBit(event.type)) mine.push_back(event);
+        }
+        if (!mine.empty()) s.handler(tick, mine);
+
+        lock.lock();
+        s.busy = false;
+        if (s.queue.empty()) s.idle.notify_all();
+    }
+}
+
+void FightObserverAdapter::operator()(uint64_t, const std::vector<WorldEvent>& events) const {
+    for (const WorldEvent& event : events) {
+        if (event.type != EventType::Fight) continue;
+        auto attacker = NPC::create(event.npcType, std::string(event.npcName), event.x, event.y);
+        auto defender = NPC::create(event.otherType, std::string(event.otherName), event.otherX, event.otherY);
+        if (event.win) defender->kill();
+
+        ScopedTimer timer(Timer::ObserverCall);
+        observer->on_fight(attacker, defender, event.win);
+        countEvent(Counter::ObserverCalls);
+    }
+}
@@ -0,0 +1,187 @@
+#include "../include/fight_log.hpp"
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+const char kMagic[8] = {'N', 'P', 'C', 'F', 'L', 'O', 'G', '1'};
+const uint32_t kVersion = 2;
+
+// The log this thread last appended to and its ring there; other logs
+// look the thread's ring up in their own ringOf.
+struct LocalRing {
+    uint64_t owner = 0;
+    void* ring = nullptr;
+};
+
+thread_local LocalRing localRingCache;
+
+uint64_t nextInstanceId() {
+    static std::atomic<uint64_t> counter{1};
+    return counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
+
+AsyncFightLog::AsyncFightLog() : instanceId(nextInstanceId()) {}
+
+AsyncFightLog::~AsyncFightLog() {
+    close();
+}
+
+bool AsyncFightLog::open(const std::string& path, const World& world) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    uint32_t count = static_cast<uint32_t>(world.size());
+    bool ok = std::fwrite(kMagic, 1, sizeof(kMagic), file) == sizeof(kMagic) &&
+              std::fwrite(&kVersion, sizeof(kVersion), 1, file) == 1 && std::fwrite(&count, sizeof(count), 1, file) == 1;
+    for (size_t i = 0; ok && i < world.size(); ++i) {
+        std::string_view name = world.getName(i);
+        uint32_t generation = world.handle(i).generation();
+        uint32_t length = static_cast<uint32_t>(name.size());
+        ok = std::fwrite(&generation, sizeof(generation), 1, file) == 1 && std::fwrite(&length, sizeof(length), 1, file) == 1 &&
+             std::fwrite(name.data(), 1, name.size(), file) == name.size();
+    }
+    if (!ok || std::fflush(file) != 0) {
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    failed.store(false);
+    stopping.store(false);
+    writer = std::thread([this]() { writerLoop(); });
+    return true;
+}
+
+void AsyncFightLog::close() {
+    if (!file) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping.store(true);
+    }
+    wakeCV.notify_one();
+    if (writer.joinable()) writer.join();
+    std::fclose(file);
+    file = nullptr;
+}
+
+AsyncFightLog::Ring& AsyncFightLog::localRing() {
+    if (localRingCache.owner == instanceId) return *static_cast<Ring*>(localRingCache.ring);
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    Ring*& ring = ringOf[std::this_thread::get_id()];
+    if (!ring) {
+        rings.push_back(std::make_unique<Ring>());
+        ring = rings.back().get();
+    }
+    localRingCache.owner = instanceId;
+    localRingCache.ring = ring;
+    return *ring;
+}
+
+size_t AsyncFightLog::getRings() {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    return rings.size();
+}
+
+void AsyncFightLog::append(const FightRecord& record) {
+    if (!file) return;
+    Ring& ring = localRing();
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    while (head - ring.tail.load(std::memory_order_acquire) >= Ring::kCapacity) {
+        stalls.fetch_add(1, std::memory_order_relaxed);
+        wakeCV.notify_one();
+        std::this_thread::yield();
+    }
+    ring.records[head % Ring::kCapacity] = record;
+    ring.head.store(head + 1, std::memory_order_release);
+
+    if (head - ring.tail.load(std::memory_order_relaxed) == Ring::kCapacity / 2) wakeCV.notify_one();
+}
+
+size_t AsyncFightLog::drain(std::vector<FightRecord>& batch) {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    size_t total = 0;
+    for (auto& ring : rings) {
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+        for (size_t k = tail; k != head; ++k) {
+            batch.push_back(ring->records[k % Ring::kCapacity]);
+        }
+        ring->tail.store(head, std::memory_order_release);
+        total += head - tail;
+    }
+    return total;
+}
+
+void AsyncFightLog::writerLoop() {
+    std::vector<FightRecord> batch;
+    batch.reserve(Ring::kCapacity);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCV.wait_for(lock, std::chrono::milliseconds(20), [this]() { return stopping.load(); });
+        }
+        bool stop = stopping.load();
+
+        batch.clear();
+        if (drain(batch) > 0 && !failed.load(std::memory_order_relaxed)) {
+            if (std::fwrite(batch.data(), sizeof(FightRecord), batch.size(), file) == batch.size() && std::fflush(file) == 0) {
+                written.fetch_add(batch.size(), std::memory_order_relaxed);
+            } else {
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+        if (stop) break;
+    }
+}
+
+bool FightLogReader::open(const std::string& path) {
+    is.open(path, std::ios::binary);
+    if (!is) return false;
+
+    char magic[8];
+    uint32_t version = 0;
+    uint32_t count = 0;
+    is.read(magic, sizeof(magic));
+    is.read(reinterpret_cast<char*>(&version), sizeof(version));
+    is.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!is || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion) return false;
+
+    names.resize(count);
+    generations.resize(count);
+    for (uint32_t i = 0; i < count && is; ++i) {
+        uint32_t length = 0;
+        is.read(reinterpret_cast<char*>(&generations[i]), sizeof(uint32_t));
+        is.read(reinterpret_cast<char*>(&length), sizeof(length));
+        names[i].resize(length);
+        is.read(&names[i][0], length);
+    }
+    return static_cast<bool>(is);
+}
+
+bool FightLogReader::next(FightRecord& record) {
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&record), sizeof(record)));
+}
+
+std::string FightLogReader::nameOf(uint32_t id, uint8_t type) const {
+    if (id < names.size()) return names[id];
+    return typeName(static_cast<NpcType>(type)) + std::to_string(id);
+}
+
+bool writeTextRecord(std::ostream& os, const FightRecord& record, const FightLogReader& reader) {
+    if (!reader.knows(record.attacker, record.attackerGeneration) || !reader.knows(record.defender, record.defenderGeneration)) {
+        return false;
+    }
+    if (!record.win) return true;
+    os << "\n" << "Убийца --------" << "\n";
+    os << "[" << typeName(static_cast<NpcType>(record.attackerType)) << "] " << reader.nameOf(record.attacker, record.attackerType)
+       << " @ (" << record.attackerX << ", " << record.attackerY << ")\n";
+    os << "[" << typeName(static_cast<NpcType>(record.defenderType)) << "] " << reader.nameOf(record.defender, record.defenderType)
+       << " @ (" << record.defenderX << ", " << record.defenderY << ")\n";
+    return true;
+}
@@ -0,0 +1,100 @@
+#include "../include/map_view.hpp"
+#include <algorithm>
+
+MapView::MapView(const OccupancyGrid& grid, int zoom, int maxCols, int maxRows)
+    : grid(grid), zoom(std::max(1, zoom)), maxCols(std::max(1, maxCols)), maxRows(std::max(1, maxRows)) {
+    resize();
+}
+
+void MapView::setZoom(int value) {
+    zoom = std::max(1, value);
+    resize();
+}
+
+void MapView::setOrigin(int col, int row) {
+    originCol = std::max(0, col);
+    originRow = std::max(0, row);
+    resize();
+}
+
+void MapView::resize() {
+    const int fullCols = (grid.getCols() + zoom - 1) / zoom;
+    const int fullRows = (grid.getRows() + zoom - 1) / zoom;
+    originCol = std::min(originCol, fullCols - 1);
+    originRow = std::min(originRow, fullRows - 1);
+    cols = std::min(maxCols, fullCols - originCol);
+    rows = std::min(maxRows, fullRows - originRow);
+    frame.assign(static_cast<size_t>(cols) * rows, ' ');
+    drawn = false;
+}
+
+char MapView::glyphAt(const OccupancyGrid& source, int col, int row) const {
+    uint32_t best[kSpeciesCount] = {};
+    const int c0 = (originCol + col) * zoom, r0 = (originRow + row) * zoom;
+    const int c1 = std::min(c0 + zoom, grid.getCols()), r1 = std::min(r0 + zoom, grid.getRows());
+    for (int r = r0; r < r1; ++r) {
+        for (int c = c0; c < c1; ++c) {
+            for (size_t t = 0; t < kSpeciesCount; ++t) {
+                best[t] += source.count(c, r, static_cast<NpcType>(t));
+            }
+        }
+    }
+    size_t top = 0;
+    for (size_t t = 1; t < kSpeciesCount; ++t) {
+        if (best[t] > best[top]) top = t;
+    }
+    return best[top] ? kSpecies[top].glyph : '.';
+}
+
+std::string MapView::title() const {
+    const int unit = grid.getCellSize() * zoom;
+    return "=== MAP x" + std::to_string(unit) + " @ (" + std::to_string(originCol * unit) + ", " +
+           std::to_string(originRow * unit) + ") ===";
+}
+
+std::string MapView::render(const OccupancyGrid& source, bool ansi) {
+    next.resize(frame.size());
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            next[static_cast<size_t>(row) * cols + col] = glyphAt(source, col, row);
+        }
+    }
+
+    std::string out;
+    if (!ansi || !drawn) {
+        out.reserve(frame.size() + static_cast<size_t>(rows) + 64);
+        if (ansi) out += "\x1b[H\x1b[2J";
+        out += title();
+        out += '\n';
+        for (int row = 0; row < rows; ++row) {
+            out.append(&next[static_cast<size_t>(row) * cols], static_cast<size_t>(cols));
+            out += '\n';
+        }
+        if (ansi) {
+            // Confine scrolling to the lines below the map so other console
+            // output never moves it, and park the cursor there.
+            const std::string below = std::to_string(frameHeight() + 1);
+            out += "\x1b[" + below + "r\x1b[" + below + ";1H";
+        }
+        drawn = ansi;
+    } else {
+        // Save the cursor, patch the changed characters, restore it: log
+        // output below the map keeps its position.
+        out += "\x1b" "7";
+        for (int row = 0; row < rows; ++row) {
+            for (int col = 0; col < cols; ++col) {
+                const size_t k = static_cast<size_t>(row) * cols + col;
+                if (next[k] == frame[k]) continue;
+                out += "\x1b[" + std::to_string(row + 2) + ";" + std::to_string(col + 1) + "H";
+                // Runs of adjacent changes share one cursor move.
+                while (col < cols && next[static_cast<size_t>(row) * cols + col] != frame[static_cast<size_t>(row) * cols + col]) {
+                    out += next[static_cast<size_t>(row) * cols + col];
+                    ++col;
+                }
+            }
+        }
+        out += "\x1b" "8";
+    }
+    frame.swap(next);
+    return out;
+}
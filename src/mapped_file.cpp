@@ -0,0 +1,67 @@
+#include "../include/mapped_file.hpp"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NPC_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef NPC_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    opened = true;
+    if (length > 0) {
+        void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            opened = false;
+            return false;
+        }
+        ::madvise(p, length, MADV_SEQUENTIAL);
+        begin = static_cast<const char*>(p);
+        mapped = true;
+    }
+    ::close(fd);
+    return true;
+#else
+    std::ifstream is(path, std::ios::binary | std::ios::ate);
+    if (!is) return false;
+    buffer.resize(static_cast<size_t>(is.tellg()));
+    is.seekg(0);
+    is.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (!is) return false;
+    begin = buffer.data();
+    length = buffer.size();
+    opened = true;
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef NPC_HAVE_MMAP
+    if (mapped) ::munmap(const_cast<char*>(begin), length);
+#endif
+    buffer.clear();
+    begin = nullptr;
+    length = 0;
+    opened = false;
+    mapped = false;
+}
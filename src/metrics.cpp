@@ -0,0 +1,166 @@
+#include "../include/metrics.hpp"
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+const char* const kCounterNames[] = {
+    "ticks", "pairs_tested", "contacts_found", "tasks_queued", "tasks_dropped",
+    "tasks_coalesced", "claim_failures", "fights", "kills", "observer_calls",
+    "tiles_active", "tiles_dormant",
+};
+
+const char* const kTimerNames[] = {
+    "phase_move", "phase_detect_contacts", "phase_resolve_fights", "phase_notify",
+    "observer_call",
+};
+
+static_assert(sizeof(kCounterNames) / sizeof(kCounterNames[0]) == static_cast<size_t>(Counter::Count),
+              "every Counter needs a name");
+static_assert(sizeof(kTimerNames) / sizeof(kTimerNames[0]) == static_cast<size_t>(Timer::Count),
+              "every Timer needs a name");
+
+// Smallest b with ns < 2^b, clamped to the overflow bucket.
+size_t bucketOf(uint64_t ns) {
+    const size_t b = ns == 0 ? 0 : static_cast<size_t>(64 - __builtin_clzll(ns));
+    return b < LatencyHistogram::kBuckets ? b : LatencyHistogram::kBuckets - 1;
+}
+
+uint64_t bucketLimitNs(size_t b) {
+    return uint64_t{1} << b;
+}
+
+}
+
+const char* counterName(Counter counter) {
+    return kCounterNames[static_cast<size_t>(counter)];
+}
+
+const char* timerName(Timer timer) {
+    return kTimerNames[static_cast<size_t>(timer)];
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    samples.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    samples.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::quantileNs(double q) const {
+    const uint64_t total = count();
+    if (total == 0) return 0;
+    const uint64_t target = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        seen += bucket(b);
+        if (seen >= target) return bucketLimitNs(b);
+    }
+    return bucketLimitNs(kBuckets - 1);
+}
+
+Metrics& Metrics::global() {
+    static Metrics instance;
+    return instance;
+}
+
+void Metrics::reset() {
+    for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+    for (auto& t : timers) t.reset();
+}
+
+void Metrics::writeJson(std::ostream& os) const {
+    os << "{\n  \"enabled\": " << (NPC_METRICS ? "true" : "false") << ",\n  \"counters\": {";
+    for (size_t c = 0; c < counters.size(); ++c) {
+        os << (c ? ", " : "") << "\"" << kCounterNames[c] << "\": " << counters[c].load(std::memory_order_relaxed);
+    }
+    os << "},\n  \"timers\": {";
+    for (size_t t = 0; t < timers.size(); ++t) {
+        const LatencyHistogram& h = timers[t];
+        os << (t ? "," : "") << "\n    \"" << kTimerNames[t] << "\": {\"count\": " << h.count()
+           << ", \"sum_ns\": " << h.sumNs() << ", \"p50_ns\": " << h.quantileNs(0.5)
+           << ", \"p99_ns\": " << h.quantileNs(0.99) << ", \"buckets\": [";
+        size_t last = LatencyHistogram::kBuckets;
+        while (last > 0 && h.bucket(last - 1) == 0) --last;
+        for (size_t b = 0; b < last; ++b) {
+            os << (b ? ", " : "") << "[" << bucketLimitNs(b) << ", " << h.bucket(b) << "]";
+        }
+        os << "]}";
+    }
+    os << "\n  }\n}\n";
+}
+
+void Metrics::writePrometheus(std::ostream& os) const {
+    for (size_t c = 0; c < counters.size(); ++c) {
+        os << "# TYPE npc_" << kCounterNames[c] << "_total counter\n"
+           << "npc_" << kCounterNames[c] << "_total " << counters[c].load(std::memory_order_relaxed) << "\n";
+    }
+    for (size_t t = 0; t < timers.size(); ++t) {
+        const LatencyHistogram& h = timers[t];
+        const std::string name = std::string("npc_") + kTimerNames[t] + "_seconds";
+        os << "# TYPE " << name << " histogram\n";
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b + 1 < LatencyHistogram::kBuckets; ++b) {
+            cumulative += h.bucket(b);
+            os << name << "_bucket{le=\"" << static_cast<double>(bucketLimitNs(b)) * 1e-9 << "\"} " << cumulative << "\n";
+        }
+        os << name << "_bucket{le=\"+Inf\"} " << h.count() << "\n"
+           << name << "_sum " << static_cast<double>(h.sumNs()) * 1e-9 << "\n"
+           << name << "_count " << h.count() << "\n";
+    }
+}
+
+MetricsDumper::~MetricsDumper() {
+    stop();
+}
+
+bool MetricsDumper::start(const std::string& target, MetricsFormat fmt, std::chrono::milliseconds every) {
+    stop();
+    path = target;
+    format = fmt;
+    interval = every;
+    if (!dump()) {
+        path.clear();
+        return false;
+    }
+    stopping = false;
+    thread = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!cv.wait_for(lock, interval, [this]() { return stopping; })) {
+            dump();
+        }
+    });
+    return true;
+}
+
+void MetricsDumper::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+    dump();
+}
+
+bool MetricsDumper::dump() const {
+    if (path.empty()) return false;
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::trunc);
+        if (!os) return false;
+        if (format == MetricsFormat::Json) {
+            Metrics::global().writeJson(os);
+        } else {
+            Metrics::global().writePrometheus(os);
+        }
+        if (!os) return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
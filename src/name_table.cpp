@@ -0,0 +1,164 @@
+#include "../include/name_table.hpp"
+#include "../include/thread_pool.hpp"
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+size_t NameTable::findSlot(std::string_view name, size_t hash) const {
+    const size_t mask = slotCount - 1;
+    for (size_t s = hash & mask;; s = (s + 1) & mask) {
+        const uint32_t held = slots[s].load(std::memory_order_relaxed);
+        if (held == 0 || views[held - 1] == name) return s;
+    }
+}
+
+void NameTable::rehash(size_t capacity) {
+    size_t size = 16;
+    while (size < capacity) size <<= 1;
+    if (size <= slotCount) return;
+    slots.reset(new std::atomic<uint32_t>[size]);
+    slotCount = size;
+    for (size_t s = 0; s < size; ++s) slots[s].store(0, std::memory_order_relaxed);
+    for (size_t id = 0; id < views.size(); ++id) {
+        const size_t s = findSlot(views[id], std::hash<std::string_view>()(views[id]));
+        slots[s].store(static_cast<uint32_t>(id + 1), std::memory_order_relaxed);
+    }
+}
+
+uint32_t NameTable::intern(std::string_view name) {
+    if ((views.size() + 1) * 2 > slotCount) rehash((views.size() + 1) * 2);
+    const size_t hash = std::hash<std::string_view>()(name);
+    const size_t slot = findSlot(name, hash);
+    if (const uint32_t held = slots[slot].load(std::memory_order_relaxed)) return held - 1;
+
+    char* dest;
+    if (name.size() > kChunkSize / 4) {
+        // Long names get a chunk of their own; the current chunk keeps
+        // filling afterwards.
+        chunks.push_back(std::make_unique<char[]>(name.size()));
+        dest = chunks.back().get();
+    } else {
+        if (!current || kChunkSize - chunkUsed < name.size()) {
+            chunks.push_back(std::make_unique<char[]>(kChunkSize));
+            current = chunks.back().get();
+            chunkUsed = 0;
+        }
+        dest = current + chunkUsed;
+        chunkUsed += name.size();
+    }
+    if (!name.empty()) std::memcpy(dest, name.data(), name.size());
+    stored += name.size();
+
+    const uint32_t id = static_cast<uint32_t>(views.size());
+    views.emplace_back(dest, name.size());
+    slots[slot].store(id + 1, std::memory_order_relaxed);
+    return id;
+}
+
+void NameTable::assign(const std::string_view* names, size_t count, uint32_t* ids, ThreadPool& pool) {
+    clear();
+    if (count == 0) return;
+    const size_t grain = 1 << 14;
+    const size_t parts = (count + grain - 1) / grain;
+
+    size_t capacity = 16;
+    while (capacity < count * 2) capacity <<= 1;
+    const size_t mask = capacity - 1;
+
+    // The index is first filled as a lock-free linear-probing set of input
+    // positions + 1, probed exactly as findSlot() does. Equal names meet in
+    // one slot, which ends up holding the lowest position: the name's first
+    // occurrence. Those positions are then replaced by ids in place.
+    slots.reset(new std::atomic<uint32_t>[capacity]);
+    slotCount = capacity;
+    std::atomic<uint32_t>* first = slots.get();
+    pool.parallelFor(0, capacity, grain, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) first[s].store(0, std::memory_order_relaxed);
+    });
+    std::vector<size_t> slotOf(count);
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t mine = static_cast<uint32_t>(i + 1);
+            size_t s = std::hash<std::string_view>()(names[i]) & mask;
+            while (true) {
+                uint32_t held = first[s].load(std::memory_order_acquire);
+                if (held == 0) {
+                    if (first[s].compare_exchange_strong(held, mine, std::memory_order_acq_rel)) break;
+                    continue;
+                }
+                if (names[held - 1] == names[i]) {
+                    while (held > mine && !first[s].compare_exchange_weak(held, mine, std::memory_order_acq_rel)) {
+                    }
+                    break;
+                }
+                s = (s + 1) & mask;
+            }
+            slotOf[i] = s;
+        }
+    });
+
+    // ids[] holds each name's first position until it is given its id.
+    // First occurrences get ids in input order; their characters go to one
+    // chunk at offsets from a prefix sum over the parts.
+    std::vector<uint8_t> isFirst(count);
+    std::vector<size_t> newNames(parts), newBytes(parts);
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ids[i] = first[slotOf[i]].load(std::memory_order_relaxed) - 1;
+            isFirst[i] = ids[i] == i;
+            if (!isFirst[i]) continue;
+            ++newNames[i / grain];
+            newBytes[i / grain] += names[i].size();
+        }
+    });
+    size_t unique = 0;
+    for (size_t p = 0; p < parts; ++p) {
+        const size_t n = newNames[p], b = newBytes[p];
+        newNames[p] = unique;
+        newBytes[p] = stored;
+        unique += n;
+        stored += b;
+    }
+    char* block = nullptr;
+    if (stored > 0) {
+        chunks.push_back(std::make_unique<char[]>(stored));
+        block = chunks.back().get();
+    }
+    views.resize(unique);
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        size_t id = 0, offset = 0;
+        for (size_t i = begin; i < end; ++i) {
+            if (i % grain == 0) {
+                id = newNames[i / grain];
+                offset = newBytes[i / grain];
+            }
+            if (!isFirst[i]) continue;
+            if (!names[i].empty()) std::memcpy(block + offset, names[i].data(), names[i].size());
+            views[id] = std::string_view(block + offset, names[i].size());
+            ids[i] = static_cast<uint32_t>(id);
+            first[slotOf[i]].store(static_cast<uint32_t>(id + 1), std::memory_order_relaxed);
+            ++id;
+            offset += names[i].size();
+        }
+    });
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (!isFirst[i]) ids[i] = ids[ids[i]];
+        }
+    });
+}
+
+void NameTable::reserve(size_t count) {
+    views.reserve(count);
+    rehash(count * 2);
+}
+
+void NameTable::clear() {
+    chunks.clear();
+    current = nullptr;
+    chunkUsed = 0;
+    stored = 0;
+    views.clear();
+    slots.reset();
+    slotCount = 0;
+}
@@ -1,4 +1,8 @@
 #include "../include/npc_system.hpp"
+#include "../include/metrics.hpp"
+#include "../include/range_kernel.hpp"
+#include "../include/rng.hpp"
+#include <climits>
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
@@ -9,167 +13,144 @@ std::shared_ptr<NPC> NPC::load(std::ifstream& is) {
     is >> type >> name >> x >> y;
     if (!is) return nullptr;
 
-    if (type == "Bear") return std::make_shared<Bear>(name, x, y);
-    if (type == "Duck") return std::make_shared<Duck>(name, x, y);
-    if (type == "Desman") return std::make_shared<Desman>(name, x, y);
+    for (size_t t = 0; t < kSpeciesCount; ++t) {
+        if (type == kSpecies[t].name) return create(static_cast<NpcType>(t), name, x, y);
+    }
     throw std::runtime_error("Unknown NPC type: " + type);
 }
 
+std::shared_ptr<NPC> NPC::create(NpcType type, const std::string& name, int x, int y) {
+    switch (type) {
+        case NpcType::Bear: return std::make_shared<Bear>(name, x, y);
+        case NpcType::Duck: return std::make_shared<Duck>(name, x, y);
+        case NpcType::Desman: return std::make_shared<Desman>(name, x, y);
+    }
+    throw std::runtime_error("Unknown NPC type id");
+}
+
 void NPC::moveRandomly(int mapSizeX, int mapSizeY) {
     if (!isAlive()) return;
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dx(-moveDistance, moveDistance);
-    std::uniform_int_distribution<> dy(-moveDistance, moveDistance);
+    CounterRng rng(simulationSeed(), id, draws.fetch_add(1, std::memory_order_relaxed), RngStream::Move);
 
-    int newX = x + dx(gen);
-    int newY = y + dy(gen);
+    const uint64_t p = pos.load(std::memory_order_relaxed);
+    int newX = unpackX(p) + rng.uniform(-moveDistance, moveDistance);
+    int newY = unpackY(p) + rng.uniform(-moveDistance, moveDistance);
 
-    x = std::max(0, std::min(newX, mapSizeX - 1));
-    y = std::max(0, std::min(newY, mapSizeY - 1));
+    pos.store(pack(std::max(0, std::min(newX, mapSizeX - 1)), std::max(0, std::min(newY, mapSizeY - 1))),
+              std::memory_order_relaxed);
 }
 
 bool NPC::isInRangeForKill(const NPC& other) const {
     if (!isAlive() || !other.isAlive()) return false;
-    double dist = std::hypot(x - other.x, y - other.y);
-    return dist <= killDistance;
+    const uint64_t a = pos.load(std::memory_order_relaxed);
+    const uint64_t b = other.pos.load(std::memory_order_relaxed);
+    return inRange(unpackX(a), unpackY(a), unpackX(b), unpackY(b), killDistance);
+}
+
+bool NPC::kill() {
+    uint8_t s = state.load(std::memory_order_relaxed);
+    while (s & kAlive) {
+        if (state.compare_exchange_weak(s, static_cast<uint8_t>(s & ~kAlive), std::memory_order_acq_rel)) return true;
+    }
+    return false;
+}
+
+bool NPC::tryClaim() {
+    uint8_t expected = kAlive;
+    return state.compare_exchange_strong(expected, static_cast<uint8_t>(kAlive | kClaimed), std::memory_order_acquire);
 }
 
 int NPC::rollDice() const {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dice(1, 6);
-    return dice(gen);
+    CounterRng rng(simulationSeed(), id, draws.fetch_add(1, std::memory_order_relaxed), RngStream::Dice);
+    return rng.uniform(1, species(typeId()).diceSides);
 }
 
-std::tuple<int, int> NPC::position() const {
-    std::lock_guard<std::mutex> lck(mtx);
-    return std::make_tuple(x, y);
+uint32_t NPC::nextId() {
+    static std::atomic<uint32_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed);
 }
 
-void NPC::subscribe(std::shared_ptr<IFightObserver> observer) {
-    std::lock_guard<std::mutex> lck(mtx);
-    observers.push_back(observer);
+std::tuple<int, int> NPC::position() const {
+    const uint64_t p = pos.load(std::memory_order_relaxed);
+    return std::make_tuple(unpackX(p), unpackY(p));
 }
 
-void NPC::fight_notify(const std::shared_ptr<NPC> defender, bool win) {
-    std::lock_guard<std::mutex> lck(mtx);
+void NPC::subscribe(std::shared_ptr<IFightObserver> observer) {
+    auto current = std::atomic_load(&observers);
+    std::shared_ptr<const ObserverList> next;
+    do {
+        auto copy = std::make_shared<ObserverList>(current ? *current : ObserverList{});
+        copy->push_back(observer);
+        next = std::move(copy);
+    } while (!std::atomic_compare_exchange_weak(&observers, &current, next));
+}
+
+void NPC::fight_notify(const std::shared_ptr<NPC>& defender, bool win) {
+    auto list = std::atomic_load(&observers);
+    if (!list) return;
     auto self = shared_from_this();
-    for (auto &o : observers) {
+    for (auto &o : *list) {
+        ScopedTimer timer(Timer::ObserverCall);
         o->on_fight(self, defender, win);
     }
+    countEvent(Counter::ObserverCalls, list->size());
 }
 
 bool NPC::is_close(const std::shared_ptr<NPC> &other, size_t distance) {
-    std::lock_guard<std::mutex> lck(mtx);
+    const auto [self_x, self_y] = position();
     const auto [other_x, other_y] = other->position();
-    if ((std::pow(x - other_x, 2) + std::pow(y - other_y, 2)) <= std::pow(distance, 2))
-        return true;
-    else
-        return false;
+    return inRange(self_x, self_y, other_x, other_y, static_cast<int>(std::min<size_t>(distance, INT_MAX)));
 }
 
 void NPC::print(std::ostream& os) const {
-    os << "[" << getType() << "] " << name << " @ (" << x << ", " << y << ")\n";
-}
-
-void Bear::accept(Visitor& visitor) {
-    visitor.visit(std::static_pointer_cast<Bear>(shared_from_this()));
+    const auto [px, py] = position();
+    os << "[" << getType() << "] " << name << " @ (" << px << ", " << py << ")\n";
 }
 
-bool Bear::fight(std::shared_ptr<NPC> other) {
-    if (!other || !other->isAlive()) return false;
-
-    if (dynamic_cast<Duck*>(other.get()) || dynamic_cast<Desman*>(other.get())) {
-        int attackPower = rollDice();
-        int defensePower = other->rollDice();
-
-        if (attackPower > defensePower) {
-            other->kill();
-            fight_notify(other, true);
-            return true;
-        }
-        fight_notify(other, false);
-        return true;
+bool NPC::fight(NPC& other) {
+    if (!canAttack(typeId(), other.typeId())) return false;
+    if (!tryClaim()) return false;
+    if (!other.tryClaim()) {
+        release();
+        return false;
     }
 
-    return false;
-}
+    int attackPower = rollDice();
+    int defensePower = other.rollDice();
+    bool win = attackPower > defensePower && other.kill();
+    other.release();
+    release();
 
-void Bear::save(std::ofstream& os) const {
-    os << "Bear " << name << " " << x << " " << y << "\n";
+    if (std::atomic_load(&observers)) fight_notify(other.weak_from_this().lock(), win);
+    return true;
 }
 
-std::mutex TextObserver::print_mutex;
-
-void Duck::accept(Visitor& visitor) {
-    visitor.visit(std::static_pointer_cast<Duck>(shared_from_this()));
+void NPC::save(std::ofstream& os) const {
+    const auto [px, py] = position();
+    os << typeName(typeId()) << " " << name << " " << px << " " << py << "\n";
 }
 
-bool Duck::fight(std::shared_ptr<NPC> other) {
-    return false;
+void Bear::accept(Visitor& visitor) {
+    visitor.visit(*this);
 }
 
-void Duck::save(std::ofstream& os) const {
-    os << "Duck " << name << " " << x << " " << y << "\n";
+void Duck::accept(Visitor& visitor) {
+    visitor.visit(*this);
 }
 
 void Desman::accept(Visitor& visitor) {
-    visitor.visit(std::static_pointer_cast<Desman>(shared_from_this()));
-}
-
-bool Desman::fight(std::shared_ptr<NPC> other) {
-    if (!other || !other->isAlive()) return false;
-
-    if (dynamic_cast<Bear*>(other.get())) {
-        int attackPower = rollDice();
-        int defensePower = other->rollDice();
-
-        if (attackPower > defensePower) {
-            other->kill();
-            fight_notify(other, true);
-            return true;
-        }
-        fight_notify(other, false);
-        return true;
-    }
-
-    return false;
-}
-
-void Desman::save(std::ofstream& os) const {
-    os << "Desman " << name << " " << x << " " << y << "\n";
+    visitor.visit(*this);
 }
 
-void BattleVisitor::visit(std::shared_ptr<Bear> target) {
-    if (!attacker || !attacker->isAlive() || !target || !target->isAlive()) return;
-    if (attacker->isInRangeForKill(*target)) {
+void BattleVisitor::engage(NPC& target) {
+    if (!attacker || !attacker->isAlive() || !target.isAlive()) return;
+    if (attacker->isInRangeForKill(target)) {
         if (attacker->fight(target)) {
             _killer = attacker->getName();
-            _victim = target->getName();
+            _victim = target.getName();
             _killOccurred = true;
         }
     }
 }
 
-void BattleVisitor::visit(std::shared_ptr<Duck> target) {
-    if (!attacker || !attacker->isAlive() || !target || !target->isAlive()) return;
-    if (attacker->isInRangeForKill(*target)) {
-        if (attacker->fight(target)) {
-            _killer = attacker->getName();
-            _victim = target->getName();
-            _killOccurred = true;
-        }
-    }
-}
-
-void BattleVisitor::visit(std::shared_ptr<Desman> target) {
-    if (!attacker || !attacker->isAlive() || !target || !target->isAlive()) return;
-    if (attacker->isInRangeForKill(*target)) {
-        if (attacker->fight(target)) {
-            _killer = attacker->getName();
-            _victim = target->getName();
-            _killOccurred = true;
-        }
-    }
-}
\ No newline at end of file
+std::mutex TextObserver::print_mutex;
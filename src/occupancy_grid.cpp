@@ -0,0 +1,45 @@
+#include "../include/occupancy_grid.hpp"
+#include <algorithm>
+
+OccupancyGrid::OccupancyGrid(int mapSizeX, int mapSizeY, int cellSize)
+    : cellSize(std::max(1, cellSize)),
+      cols(std::max(1, (mapSizeX + this->cellSize - 1) / this->cellSize)),
+      rows(std::max(1, (mapSizeY + this->cellSize - 1) / this->cellSize)),
+      counts(new std::atomic<uint32_t>[static_cast<size_t>(cols) * rows * kSpeciesCount]) {
+    clear();
+}
+
+void OccupancyGrid::copyFrom(const OccupancyGrid& other) {
+    const size_t n = static_cast<size_t>(other.cols) * other.rows * kSpeciesCount;
+    if (other.cols != cols || other.rows != rows) {
+        counts.reset(new std::atomic<uint32_t>[n]);
+    }
+    cellSize = other.cellSize;
+    cols = other.cols;
+    rows = other.rows;
+    for (size_t k = 0; k < n; ++k) {
+        counts[k].store(other.counts[k].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+void OccupancyGrid::move(NpcType type, int fromX, int fromY, int toX, int toY) {
+    const size_t from = cellIndex(fromX, fromY);
+    const size_t to = cellIndex(toX, toY);
+    if (from == to) return;
+    const size_t t = static_cast<size_t>(type);
+    counts[from * kSpeciesCount + t].fetch_sub(1, std::memory_order_relaxed);
+    counts[to * kSpeciesCount + t].fetch_add(1, std::memory_order_relaxed);
+}
+
+void OccupancyGrid::clear() {
+    const size_t n = static_cast<size_t>(cols) * rows * kSpeciesCount;
+    for (size_t k = 0; k < n; ++k) counts[k].store(0, std::memory_order_relaxed);
+}
+
+uint32_t OccupancyGrid::total(int col, int row) const {
+    uint32_t sum = 0;
+    for (size_t t = 0; t < kSpeciesCount; ++t) {
+        sum += count(col, row, static_cast<NpcType>(t));
+    }
+    return sum;
+}
@@ -0,0 +1,133 @@
+#include "../include/range_kernel.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NPC_RANGE_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Above this distance squared lengths no longer fit the 16-bit lanes used by
+// the vector paths, so those calls stay scalar.
+const int kMaxVectorDistance = 32766;
+
+uint64_t scalarMask(int ax, int ay, const int* xs, const int* ys, size_t count, int distance) {
+    const long long r2 = static_cast<long long>(distance) * distance;
+    uint64_t mask = 0;
+    for (size_t k = 0; k < count; ++k) {
+        long long dx = static_cast<long long>(xs[k]) - ax;
+        long long dy = static_cast<long long>(ys[k]) - ay;
+        if (dx * dx + dy * dy <= r2) mask |= uint64_t{1} << k;
+    }
+    return mask;
+}
+
+#ifdef NPC_RANGE_KERNEL_X86
+
+// |v - origin| clamped to cap, then packed as (dx, dy) 16-bit pairs so that
+// one pmaddwd yields dx * dx + dy * dy per 32-bit lane.
+inline __m128i clampedDelta(__m128i v, __m128i origin, __m128i cap) {
+    __m128i d = _mm_sub_epi32(v, origin);
+    __m128i sign = _mm_srai_epi32(d, 31);
+    d = _mm_sub_epi32(_mm_xor_si128(d, sign), sign);
+    __m128i over = _mm_cmpgt_epi32(d, cap);
+    return _mm_or_si128(_mm_and_si128(over, cap), _mm_andnot_si128(over, d));
+}
+
+uint64_t sse2Mask(int ax, int ay, const int* xs, const int* ys, size_t count, int distance) {
+    const __m128i ox = _mm_set1_epi32(ax);
+    const __m128i oy = _mm_set1_epi32(ay);
+    const __m128i cap = _mm_set1_epi32(distance + 1);
+    const __m128i r2 = _mm_set1_epi32(distance * distance);
+
+    uint64_t mask = 0;
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        __m128i dx = clampedDelta(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + k)), ox, cap);
+        __m128i dy = clampedDelta(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + k)), oy, cap);
+        __m128i packed = _mm_or_si128(dx, _mm_slli_epi32(dy, 16));
+        __m128i d2 = _mm_madd_epi16(packed, packed);
+        __m128i miss = _mm_cmpgt_epi32(d2, r2);
+        uint64_t hits = ~static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(miss))) & 0xFu;
+        mask |= hits << k;
+    }
+    if (k < count) mask |= scalarMask(ax, ay, xs + k, ys + k, count - k, distance) << k;
+    return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t avx2Mask(int ax, int ay, const int* xs, const int* ys, size_t count, int distance) {
+    const __m256i ox = _mm256_set1_epi32(ax);
+    const __m256i oy = _mm256_set1_epi32(ay);
+    const __m256i cap = _mm256_set1_epi32(distance + 1);
+    const __m256i r2 = _mm256_set1_epi32(distance * distance);
+
+    uint64_t mask = 0;
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256i dx = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + k)), ox));
+        __m256i dy = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + k)), oy));
+        dx = _mm256_min_epu32(dx, cap);
+        dy = _mm256_min_epu32(dy, cap);
+        __m256i packed = _mm256_or_si256(dx, _mm256_slli_epi32(dy, 16));
+        __m256i d2 = _mm256_madd_epi16(packed, packed);
+        __m256i miss = _mm256_cmpgt_epi32(d2, r2);
+        uint64_t hits = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(miss))) & 0xFFu;
+        mask |= hits << k;
+    }
+    if (k < count) mask |= sse2Mask(ax, ay, xs + k, ys + k, count - k, distance) << k;
+    return mask;
+}
+
+#endif
+
+RangeKernelIsa detectRangeKernel() {
+#ifdef NPC_RANGE_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return RangeKernelIsa::AVX2;
+    if (__builtin_cpu_supports("sse2")) return RangeKernelIsa::SSE2;
+#endif
+    return RangeKernelIsa::Scalar;
+}
+
+}
+
+RangeKernelIsa activeRangeKernel() {
+    static const RangeKernelIsa isa = detectRangeKernel();
+    return isa;
+}
+
+bool isRangeKernelSupported(RangeKernelIsa isa) {
+    return static_cast<int>(isa) <= static_cast<int>(activeRangeKernel());
+}
+
+const char* rangeKernelName(RangeKernelIsa isa) {
+    switch (isa) {
+        case RangeKernelIsa::Scalar: return "scalar";
+        case RangeKernelIsa::SSE2: return "sse2";
+        case RangeKernelIsa::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+uint64_t rangeMaskWith(RangeKernelIsa isa, int ax, int ay, const int* xs, const int* ys, size_t count, int distance) {
+    if (count > 64) count = 64;
+    if (distance < 0) return 0;
+    if (!isRangeKernelSupported(isa) || distance > kMaxVectorDistance) isa = RangeKernelIsa::Scalar;
+
+    switch (isa) {
+#ifdef NPC_RANGE_KERNEL_X86
+        case RangeKernelIsa::AVX2: return avx2Mask(ax, ay, xs, ys, count, distance);
+        case RangeKernelIsa::SSE2: return sse2Mask(ax, ay, xs, ys, count, distance);
+#endif
+        default: return scalarMask(ax, ay, xs, ys, count, distance);
+    }
+}
+
+uint64_t rangeMask(int ax, int ay, const int* xs, const int* ys, size_t count, int distance) {
+    if (count < 4) {
+        if (distance < 0) return 0;
+        return scalarMask(ax, ay, xs, ys, count, distance);
+    }
+    return rangeMaskWith(activeRangeKernel(), ax, ay, xs, ys, count, distance);
+}
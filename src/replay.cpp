@@ -0,0 +1,124 @@
+#include "../include/replay.hpp"
+#include "../include/snapshot.hpp"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+const char kMagic[8] = {'N', 'P', 'C', 'R', 'E', 'P', 'L', '1'};
+const uint32_t kVersion = 1;
+
+std::string snapshotPath(const std::string& path) {
+    return path + ".snap";
+}
+
+struct FileCloser {
+    void operator()(std::FILE* f) const { std::fclose(f); }
+};
+
+}
+
+void ReplayRecorder::open(const std::string& path, const World& world, const RateScheduler* rates) {
+    close();
+    saveSnapshot(world, snapshotPath(path));
+
+    ReplayHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.headerSize = sizeof(ReplayHeader);
+    header.seed = world.getSeed();
+    header.rated = rates != nullptr;
+    header.speciesCount = kSpeciesCount;
+    for (size_t t = 0; t < kSpeciesCount; ++t) {
+        const UpdateRate rate = rates ? rates->getRate(static_cast<NpcType>(t)) : UpdateRate{};
+        header.moveEvery[t] = rate.moveEvery;
+        header.attackEvery[t] = rate.attackEvery;
+    }
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) throw std::runtime_error("Cannot open recording for writing: " + path);
+    std::fwrite(&header, sizeof(header), 1, file);
+    steps = 0;
+}
+
+void ReplayRecorder::close() {
+    if (!file) return;
+    std::fclose(file);
+    file = nullptr;
+}
+
+void ReplayRecorder::record(size_t attacker, size_t defender, FightResult result) {
+    ReplayStep step{};
+    step.attacker = static_cast<uint32_t>(attacker);
+    step.defender = static_cast<uint32_t>(defender);
+    step.result = static_cast<uint8_t>(result);
+    std::lock_guard<std::mutex> lock(mtx);
+    pending.push_back(step);
+}
+
+void ReplayRecorder::endTick(uint64_t tick) {
+    if (!file) return;
+    ReplayTick header{};
+    header.tick = tick;
+    header.count = static_cast<uint32_t>(pending.size());
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fwrite(pending.data(), sizeof(ReplayStep), pending.size(), file);
+    steps += pending.size();
+    pending.clear();
+}
+
+ReplayStats replaySession(World& world, const std::string& path, ThreadPool& pool) {
+    std::unique_ptr<std::FILE, FileCloser> file(std::fopen(path.c_str(), "rb"));
+    if (!file) throw std::runtime_error("Cannot open recording: " + path);
+
+    ReplayHeader header;
+    if (std::fread(&header, sizeof(header), 1, file.get()) != 1 || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a recording: " + path);
+    }
+    if (header.version != kVersion || header.headerSize != sizeof(ReplayHeader) || header.speciesCount != kSpeciesCount) {
+        throw std::runtime_error("Unsupported recording version in " + path);
+    }
+
+    loadSnapshot(world, snapshotPath(path));
+    world.setSeed(header.seed);
+
+    std::unique_ptr<RateScheduler> rates;
+    if (header.rated) {
+        rates = std::make_unique<RateScheduler>(world);
+        for (size_t t = 0; t < kSpeciesCount; ++t) {
+            rates->setRate(static_cast<NpcType>(t), {header.moveEvery[t], header.attackEvery[t]});
+        }
+        rates->scheduleAll();
+    }
+
+    ReplayStats stats;
+    ReplayTick tick;
+    std::vector<ReplayStep> steps;
+    while (std::fread(&tick, sizeof(tick), 1, file.get()) == 1) {
+        steps.resize(tick.count);
+        if (std::fread(steps.data(), sizeof(ReplayStep), steps.size(), file.get()) != steps.size()) {
+            throw std::runtime_error("Truncated recording: " + path);
+        }
+
+        while (world.getTick() < tick.tick) {
+            if (rates) {
+                rates->tick(pool);
+            } else {
+                world.beginTick();
+                pool.parallelFor(0, world.size(), 4096, [&](size_t begin, size_t end) { world.moveRange(begin, end); });
+            }
+            ++stats.ticks;
+        }
+
+        for (const ReplayStep& step : steps) {
+            if (step.attacker >= world.size() || step.defender >= world.size()) {
+                throw std::runtime_error("Recording refers to a missing NPC: " + path);
+            }
+            const FightResult result = world.fight(step.attacker, step.defender);
+            if (result != FightResult::NoFight) ++stats.fights;
+            if (static_cast<uint8_t>(result) != step.result) ++stats.mismatches;
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,52 @@
+#include "../include/rng.hpp"
+#include <atomic>
+
+namespace {
+
+std::atomic<uint64_t> globalSeed{0x853c49e6748fea9bULL};
+
+}
+
+uint64_t splitmix64(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+CounterRng::CounterRng(uint64_t seed, uint64_t id, uint64_t tick, RngStream stream, uint64_t substream) {
+    uint64_t h = splitmix64(seed);
+    h = splitmix64(h ^ id);
+    h = splitmix64(h ^ tick);
+    h = splitmix64(h ^ static_cast<uint64_t>(stream));
+    key = splitmix64(h ^ substream);
+}
+
+uint64_t CounterRng::next() {
+    return splitmix64(key + 0x9e3779b97f4a7c15ULL * counter++);
+}
+
+int CounterRng::uniform(int lo, int hi) {
+    const uint32_t range = static_cast<uint32_t>(static_cast<int64_t>(hi) - lo + 1);
+    if (range == 0) return static_cast<int>(static_cast<uint32_t>(next()));
+
+    // Lemire's multiply-and-reject keeps the result unbiased.
+    uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>(next())) * range;
+    uint32_t low = static_cast<uint32_t>(m);
+    if (low < range) {
+        const uint32_t threshold = static_cast<uint32_t>(-range) % range;
+        while (low < threshold) {
+            m = static_cast<uint64_t>(static_cast<uint32_t>(next())) * range;
+            low = static_cast<uint32_t>(m);
+        }
+    }
+    return static_cast<int>(static_cast<int64_t>(lo) + static_cast<int64_t>(m >> 32));
+}
+
+void setSimulationSeed(uint64_t seed) {
+    globalSeed.store(seed, std::memory_order_relaxed);
+}
+
+uint64_t simulationSeed() {
+    return globalSeed.load(std::memory_order_relaxed);
+}
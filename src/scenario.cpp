@@ -0,0 +1,183 @@
+#include "../include/scenario.hpp"
+#include "../include/rng.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+// Substreams of RngStream::Spawn; 0 is the per-NPC stream.
+const uint64_t kClusterStream = 1;
+
+struct Centre {
+    int x, y;
+};
+
+void skipPgmSpace(std::istream& is) {
+    while (true) {
+        int c = is.peek();
+        if (c == '#') {
+            std::string comment;
+            std::getline(is, comment);
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            is.get();
+        } else {
+            return;
+        }
+    }
+}
+
+int readPgmInt(std::istream& is, const std::string& path) {
+    skipPgmSpace(is);
+    int value = -1;
+    if (!(is >> value) || value < 0) throw std::runtime_error("Corrupt PGM header in " + path);
+    return value;
+}
+
+// Uniform integer in [lo, hi] from a full 64-bit draw.
+int pick(CounterRng& rng, int lo, int hi) {
+    return lo + static_cast<int>(rng.next() % static_cast<uint64_t>(hi - lo + 1));
+}
+
+}
+
+DensityMap loadDensityMap(const std::string& path) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is) throw std::runtime_error("Cannot open density map: " + path);
+
+    char magic[2] = {};
+    is.read(magic, 2);
+    const bool binary = magic[0] == 'P' && magic[1] == '5';
+    if (!binary && !(magic[0] == 'P' && magic[1] == '2')) throw std::runtime_error("Not a PGM image: " + path);
+
+    DensityMap map;
+    map.width = readPgmInt(is, path);
+    map.height = readPgmInt(is, path);
+    const int maxValue = readPgmInt(is, path);
+    if (map.width == 0 || map.height == 0 || maxValue == 0 || maxValue > 255) {
+        throw std::runtime_error("Unsupported PGM geometry or depth in " + path);
+    }
+
+    const size_t pixels = static_cast<size_t>(map.width) * map.height;
+    map.weights.resize(pixels);
+    if (binary) {
+        is.get();
+        is.read(reinterpret_cast<char*>(map.weights.data()), static_cast<std::streamsize>(pixels));
+        if (static_cast<size_t>(is.gcount()) != pixels) throw std::runtime_error("Truncated PGM image: " + path);
+    } else {
+        for (size_t p = 0; p < pixels; ++p) {
+            map.weights[p] = static_cast<uint8_t>(std::min(readPgmInt(is, path), maxValue));
+        }
+    }
+    return map;
+}
+
+void generateScenario(World& world, const ScenarioSpec& spec, ThreadPool& pool) {
+    uint64_t ratioTotal = 0;
+    for (uint32_t r : spec.ratios) ratioTotal += r;
+    if (ratioTotal == 0) throw std::invalid_argument("Scenario needs at least one non-zero species ratio");
+    // The species is drawn with CounterRng::uniform over [0, total).
+    if (ratioTotal > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+        throw std::invalid_argument("Scenario species ratios must sum to at most " +
+                                    std::to_string(std::numeric_limits<int>::max()));
+    }
+    if (spec.distribution == Distribution::Density && !spec.density) {
+        throw std::invalid_argument("Density scenario needs a density map");
+    }
+
+    const int mapX = world.getMapSizeX();
+    const int mapY = world.getMapSizeY();
+    const size_t count = spec.count;
+
+    std::vector<Centre> centres;
+    if (spec.distribution == Distribution::Clustered) {
+        centres.resize(std::max<size_t>(1, spec.clusters));
+        for (size_t k = 0; k < centres.size(); ++k) {
+            CounterRng rng(spec.seed, k, 0, RngStream::Spawn, kClusterStream);
+            centres[k] = {rng.uniform(0, mapX - 1), rng.uniform(0, mapY - 1)};
+        }
+    }
+
+    // Cumulative pixel weights; an NPC draws a point under the curve and
+    // lands in that pixel's part of the map.
+    std::vector<uint64_t> cumulative;
+    if (spec.distribution == Distribution::Density) {
+        cumulative.resize(spec.density->weights.size());
+        uint64_t sum = 0;
+        for (size_t p = 0; p < cumulative.size(); ++p) cumulative[p] = sum += spec.density->weights[p];
+        if (sum == 0) throw std::invalid_argument("Density map is all black");
+    }
+
+    std::vector<int> xs(count), ys(count);
+    std::vector<NpcType> types(count);
+    std::vector<std::string_view> names(count);
+
+    const size_t grain = 1 << 16;
+    const size_t chunks = (count + grain - 1) / grain;
+    // Names are formatted straight into one buffer per chunk rather than
+    // built as strings; the world interns them on the pool.
+    std::vector<std::vector<char>> nameBuffers(chunks);
+
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        std::vector<char>& buffer = nameBuffers[begin / grain];
+        buffer.resize((end - begin) * 32);
+        char* out = buffer.data();
+
+        for (size_t i = begin; i < end; ++i) {
+            CounterRng rng(spec.seed, i, 0, RngStream::Spawn);
+            int x = 0, y = 0;
+            switch (spec.distribution) {
+                case Distribution::Uniform:
+                    x = rng.uniform(0, mapX - 1);
+                    y = rng.uniform(0, mapY - 1);
+                    break;
+                case Distribution::Clustered: {
+                    const Centre& c = centres[static_cast<size_t>(rng.uniform(0, static_cast<int>(centres.size()) - 1))];
+                    const int r = std::max(0, spec.clusterRadius);
+                    x = c.x + (rng.uniform(-r, r) + rng.uniform(-r, r)) / 2;
+                    y = c.y + (rng.uniform(-r, r) + rng.uniform(-r, r)) / 2;
+                    x = std::max(0, std::min(x, mapX - 1));
+                    y = std::max(0, std::min(y, mapY - 1));
+                    break;
+                }
+                case Distribution::Density: {
+                    const DensityMap& map = *spec.density;
+                    const uint64_t u = rng.next() % cumulative.back();
+                    const size_t p = static_cast<size_t>(std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin());
+                    const int px = static_cast<int>(p % static_cast<size_t>(map.width));
+                    const int py = static_cast<int>(p / static_cast<size_t>(map.width));
+                    const int x0 = static_cast<int>(static_cast<int64_t>(px) * mapX / map.width);
+                    const int y0 = static_cast<int>(static_cast<int64_t>(py) * mapY / map.height);
+                    const int x1 = std::max(x0, static_cast<int>(static_cast<int64_t>(px + 1) * mapX / map.width) - 1);
+                    const int y1 = std::max(y0, static_cast<int>(static_cast<int64_t>(py + 1) * mapY / map.height) - 1);
+                    x = pick(rng, x0, x1);
+                    y = pick(rng, y0, y1);
+                    break;
+                }
+            }
+
+            uint64_t draw = static_cast<uint64_t>(rng.uniform(0, static_cast<int>(ratioTotal) - 1));
+            size_t t = 0;
+            while (draw >= spec.ratios[t]) draw -= spec.ratios[t++];
+
+            xs[i] = x;
+            ys[i] = y;
+            types[i] = static_cast<NpcType>(t);
+
+            const char* typeText = typeName(types[i]);
+            const size_t typeLength = std::strlen(typeText);
+            char* start = out;
+            std::memcpy(out, typeText, typeLength);
+            out = std::to_chars(out + typeLength, buffer.data() + buffer.size(), i).ptr;
+            names[i] = std::string_view(start, static_cast<size_t>(out - start));
+        }
+    });
+
+    std::vector<uint8_t> alive(count, 1);
+    world.assign(mapX, mapY, count, xs.data(), ys.data(), alive.data(), types.data(), names.data(), pool);
+}
@@ -0,0 +1,32 @@
+#include "../include/scheduler.hpp"
+#include "../include/metrics.hpp"
+#include <thread>
+
+TickScheduler::TickScheduler(ThreadPool& pool, std::chrono::milliseconds tickInterval)
+    : pool(pool), tickInterval(tickInterval) {}
+
+void TickScheduler::setPhase(TickPhase phase, Phase fn) {
+    phases[static_cast<size_t>(phase)] = std::move(fn);
+}
+
+void TickScheduler::runTick() {
+    ++tick;
+    countEvent(Counter::Ticks);
+    for (size_t p = 0; p < phases.size(); ++p) {
+        if (!phases[p]) continue;
+        ScopedTimer timer(static_cast<Timer>(p));
+        phases[p](tick);
+    }
+}
+
+void TickScheduler::run(const std::atomic<bool>& running, uint64_t maxTicks) {
+    auto next = std::chrono::steady_clock::now();
+    while (running.load() && (maxTicks == 0 || tick < maxTicks)) {
+        if (tickInterval.count() > 0) {
+            next += tickInterval;
+            std::this_thread::sleep_until(next);
+            if (!running.load()) break;
+        }
+        runTick();
+    }
+}
@@ -0,0 +1,311 @@
+#include "../include/snapshot.hpp"
+#include "../include/mapped_file.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const char kMagic[8] = {'N', 'P', 'C', 'S', 'N', 'A', 'P', '1'};
+const uint32_t kVersion = 1;
+
+struct TextChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    size_t lines = 0;
+    size_t records = 0;
+    size_t firstLine = 0;
+    size_t firstRecord = 0;
+    size_t errorLine = 0;
+    std::string error;
+};
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* lineEnd(const char* p, const char* end) {
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return nl ? static_cast<const char*>(nl) : end;
+}
+
+std::string_view nextToken(const char*& p, const char* end) {
+    while (p < end && isSpace(*p)) ++p;
+    const char* start = p;
+    while (p < end && !isSpace(*p)) ++p;
+    return std::string_view(start, static_cast<size_t>(p - start));
+}
+
+bool parseType(std::string_view token, NpcType& type) {
+    for (size_t t = 0; t < kSpeciesCount; ++t) {
+        if (token == kSpecies[t].name) {
+            type = static_cast<NpcType>(t);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseInt(std::string_view token, int& value) {
+    const char* last = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), last, value);
+    return ec == std::errc() && ptr == last;
+}
+
+size_t padded(size_t bytes) {
+    return (bytes + 7) & ~size_t{7};
+}
+
+class SectionWriter {
+public:
+    explicit SectionWriter(std::ofstream& os) : os(os) {}
+
+    void write(const void* data, size_t bytes) {
+        static const char zeros[8] = {};
+        const size_t pad = padded(bytes) - bytes;
+        os.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        os.write(zeros, static_cast<std::streamsize>(pad));
+
+        // Hash the section exactly as it lands on disk, padding included.
+        const size_t whole = bytes - bytes % 8;
+        hash = snapshotChecksum(static_cast<const char*>(data), whole, hash);
+        if (whole != bytes) {
+            char tail[8] = {};
+            std::memcpy(tail, static_cast<const char*>(data) + whole, bytes - whole);
+            hash = snapshotChecksum(tail, sizeof(tail), hash);
+        }
+    }
+
+    uint64_t checksum() const { return hash; }
+
+private:
+    std::ofstream& os;
+    uint64_t hash = kSnapshotChecksumBasis;
+};
+
+}
+
+uint64_t snapshotChecksum(const char* data, size_t size, uint64_t hash) {
+    const uint64_t prime = 0x100000001b3ULL;
+    size_t k = 0;
+    for (; k + 8 <= size; k += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + k, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; k < size; ++k) {
+        hash = (hash ^ static_cast<unsigned char>(data[k])) * prime;
+    }
+    return hash;
+}
+
+void saveSnapshot(const World& world, const std::string& path) {
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    if (!os) throw std::runtime_error("Cannot open snapshot for writing: " + path);
+
+    const size_t count = world.size();
+    std::vector<uint64_t> offsets(count + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i + 1] = offsets[i] + world.getName(i).size();
+    }
+    std::string blob;
+    blob.reserve(offsets[count]);
+    for (size_t i = 0; i < count; ++i) {
+        blob += world.getName(i);
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.mapSizeX = world.getMapSizeX();
+    header.mapSizeY = world.getMapSizeY();
+    header.seed = world.getSeed();
+    header.tick = world.getTick();
+    header.count = count;
+    header.nameBytes = blob.size();
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    SectionWriter writer(os);
+    writer.write(world.xData(), count * sizeof(int32_t));
+    writer.write(world.yData(), count * sizeof(int32_t));
+    writer.write(world.aliveData(), count);
+    writer.write(world.typeData(), count);
+    writer.write(offsets.data(), offsets.size() * sizeof(uint64_t));
+    writer.write(blob.data(), blob.size());
+
+    header.checksum = writer.checksum();
+    os.seekp(0);
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!os) throw std::runtime_error("Failed to write snapshot: " + path);
+}
+
+void loadSnapshot(World& world, const std::string& path) {
+    static_assert(sizeof(int) == sizeof(int32_t), "snapshot columns are mapped as int");
+    static_assert(sizeof(NpcType) == 1, "snapshot type column is one byte per NPC");
+
+    MappedFile file;
+    if (!file.open(path)) throw std::runtime_error("Cannot open snapshot: " + path);
+    if (file.size() < sizeof(SnapshotHeader)) throw std::runtime_error("Snapshot too small: " + path);
+
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) throw std::runtime_error("Not a snapshot: " + path);
+    if (header.version != kVersion || header.headerSize != sizeof(SnapshotHeader)) {
+        throw std::runtime_error("Unsupported snapshot version in " + path);
+    }
+
+    // Bound the header's sizes by the file before any offset arithmetic so
+    // a corrupt count cannot wrap the section offsets.
+    const uint64_t perNpc = 2 * sizeof(int32_t) + 2 + sizeof(uint64_t);
+    if (header.count > (file.size() - sizeof(SnapshotHeader)) / perNpc || header.nameBytes > file.size()) {
+        throw std::runtime_error("Truncated snapshot: " + path);
+    }
+
+    const size_t count = static_cast<size_t>(header.count);
+    const size_t xOffset = sizeof(SnapshotHeader);
+    const size_t yOffset = xOffset + padded(count * sizeof(int32_t));
+    const size_t aliveOffset = yOffset + padded(count * sizeof(int32_t));
+    const size_t typeOffset = aliveOffset + padded(count);
+    const size_t namesIndexOffset = typeOffset + padded(count);
+    const size_t blobOffset = namesIndexOffset + padded((count + 1) * sizeof(uint64_t));
+    const size_t end = blobOffset + padded(static_cast<size_t>(header.nameBytes));
+    if (file.size() < end) throw std::runtime_error("Truncated snapshot: " + path);
+
+    const char* base = file.data();
+    if (snapshotChecksum(base + xOffset, end - xOffset) != header.checksum) {
+        throw std::runtime_error("Snapshot checksum mismatch: " + path);
+    }
+
+    const uint8_t* types = reinterpret_cast<const uint8_t*>(base + typeOffset);
+    for (size_t i = 0; i < count; ++i) {
+        if (types[i] >= kSpeciesCount) throw std::runtime_error("Unknown NPC type id in " + path);
+    }
+
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(base + namesIndexOffset);
+    const char* blob = base + blobOffset;
+    // Views straight into the mapping; the world copies each name once as
+    // it interns.
+    std::vector<std::string_view> names(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > header.nameBytes) {
+            throw std::runtime_error("Corrupt name table in " + path);
+        }
+        names[i] = std::string_view(blob + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]));
+    }
+
+    world.assign(header.mapSizeX, header.mapSizeY, count,
+                 reinterpret_cast<const int*>(base + xOffset),
+                 reinterpret_cast<const int*>(base + yOffset),
+                 reinterpret_cast<const uint8_t*>(base + aliveOffset),
+                 reinterpret_cast<const NpcType*>(base + typeOffset),
+                 names.data());
+    world.setSeed(header.seed);
+    world.setTick(header.tick);
+}
+
+void exportText(const World& world, std::ostream& os) {
+    for (size_t i = 0; i < world.size(); ++i) {
+        if (!world.isAlive(i)) continue;
+        os << typeName(world.getTypeId(i)) << " " << world.getName(i) << " " << world.getX(i) << " " << world.getY(i) << "\n";
+    }
+}
+
+void importText(World& world, std::istream& is) {
+    std::string type, name;
+    int x, y;
+    while (is >> type >> name >> x >> y) {
+        size_t t = 0;
+        while (t < kSpeciesCount && type != kSpecies[t].name) ++t;
+        if (t == kSpeciesCount) throw std::runtime_error("Unknown NPC type: " + type);
+        world.add(static_cast<NpcType>(t), name, x, y);
+    }
+}
+
+void loadTextFile(World& world, const std::string& path, ThreadPool& pool) {
+    MappedFile file;
+    if (!file.open(path)) throw std::runtime_error("Cannot open text file: " + path);
+    const char* data = file.data();
+    const char* const fileEnd = data + file.size();
+
+    // Chunks of at least 1 MB, a few per thread so stealing evens them out.
+    const size_t minChunk = size_t{1} << 20;
+    const size_t parts = std::max<size_t>(1, std::min(std::max<size_t>(pool.size(), 1) * 4, file.size() / minChunk));
+    std::vector<TextChunk> chunks(parts);
+    const char* cursor = data;
+    for (size_t k = 0; k < parts; ++k) {
+        const char* cut = k + 1 == parts ? fileEnd : data + file.size() * (k + 1) / parts;
+        if (cut < cursor) cut = cursor;
+        if (cut < fileEnd) cut = std::min(fileEnd, lineEnd(cut, fileEnd) + 1);
+        chunks[k].begin = cursor;
+        chunks[k].end = cut;
+        cursor = cut;
+    }
+
+    // Pass 1 counts lines and records so every chunk knows its first line
+    // number and where its records go.
+    pool.parallelFor(0, parts, 1, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            TextChunk& chunk = chunks[k];
+            for (const char* p = chunk.begin; p < chunk.end;) {
+                const char* eol = lineEnd(p, chunk.end);
+                ++chunk.lines;
+                if (std::any_of(p, eol, [](char c) { return !isSpace(c); })) ++chunk.records;
+                p = eol < chunk.end ? eol + 1 : chunk.end;
+            }
+        }
+    });
+    size_t lines = 1, records = 0;
+    for (TextChunk& chunk : chunks) {
+        chunk.firstLine = lines;
+        chunk.firstRecord = records;
+        lines += chunk.lines;
+        records += chunk.records;
+    }
+    if (records > NpcHandle::kMaxSlots) {
+        throw std::runtime_error(path + ": " + std::to_string(records) + " records exceed the World slot limit");
+    }
+
+    std::vector<int> xs(records), ys(records);
+    std::vector<NpcType> types(records);
+    std::vector<std::string_view> names(records);
+    pool.parallelFor(0, parts, 1, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            TextChunk& chunk = chunks[k];
+            size_t line = chunk.firstLine;
+            size_t r = chunk.firstRecord;
+            for (const char* p = chunk.begin; p < chunk.end; ++line) {
+                const char* eol = lineEnd(p, chunk.end);
+                std::string_view typeToken = nextToken(p, eol);
+                if (!typeToken.empty()) {
+                    std::string_view name = nextToken(p, eol);
+                    std::string_view xToken = nextToken(p, eol);
+                    std::string_view yToken = nextToken(p, eol);
+                    if (yToken.empty() || !nextToken(p, eol).empty()) {
+                        chunk.error = "expected \"<Type> <name> <x> <y>\"";
+                    } else if (!parseType(typeToken, types[r])) {
+                        chunk.error = "unknown NPC type '" + std::string(typeToken) + "'";
+                    } else if (!parseInt(xToken, xs[r]) || !parseInt(yToken, ys[r])) {
+                        chunk.error = "bad coordinates '" + std::string(xToken) + " " + std::string(yToken) + "'";
+                    }
+                    if (!chunk.error.empty()) {
+                        chunk.errorLine = line;
+                        break;
+                    }
+                    names[r++] = name;
+                }
+                p = eol < chunk.end ? eol + 1 : chunk.end;
+            }
+        }
+    });
+    for (const TextChunk& chunk : chunks) {
+        if (chunk.errorLine) throw std::runtime_error(path + ":" + std::to_string(chunk.errorLine) + ": " + chunk.error);
+    }
+
+    std::vector<uint8_t> alive(records, 1);
+    world.assign(world.getMapSizeX(), world.getMapSizeY(), records, xs.data(), ys.data(), alive.data(), types.data(),
+                 names.data());
+}
@@ -0,0 +1,168 @@
+#include "../include/spatial_grid.hpp"
+#include "../include/metrics.hpp"
+#include "../include/range_kernel.hpp"
+#include <algorithm>
+
+int SpatialGrid::cellOf(int coord) const {
+    return coord >= 0 ? coord / cellSize : -((-coord + cellSize - 1) / cellSize);
+}
+
+void SpatialGrid::rebuild(const std::vector<std::shared_ptr<NPC>>& npcs) {
+    cellSize = 1;
+    for (const auto& npc : npcs) {
+        if (npc && npc->isAlive()) cellSize = std::max(cellSize, npc->getKillDistance());
+    }
+
+    entries.clear();
+    cellList.clear();
+    cells.clear();
+    for (size_t i = 0; i < npcs.size(); ++i) {
+        if (!npcs[i] || !npcs[i]->isAlive()) continue;
+        entries.push_back({cellKey(cellOf(npcs[i]->getX()), cellOf(npcs[i]->getY())), i});
+    }
+    buildCells();
+}
+
+template <typename IndexAt>
+void SpatialGrid::rebuildFrom(const World& world, size_t count, IndexAt indexAt) {
+    const int* xs = world.xData();
+    const int* ys = world.yData();
+    const uint8_t* alive = world.aliveData();
+    const int* kill = world.killDistanceData();
+
+    cellSize = 1;
+    for (size_t k = 0; k < count; ++k) {
+        const size_t i = indexAt(k);
+        if (alive[i]) cellSize = std::max(cellSize, kill[i]);
+    }
+
+    entries.clear();
+    cellList.clear();
+    cells.clear();
+    for (size_t k = 0; k < count; ++k) {
+        const size_t i = indexAt(k);
+        if (!alive[i]) continue;
+        entries.push_back({cellKey(cellOf(xs[i]), cellOf(ys[i])), i});
+    }
+    buildCells();
+}
+
+void SpatialGrid::rebuild(const World& world) {
+    rebuildFrom(world, world.size(), [](size_t k) { return k; });
+}
+
+void SpatialGrid::rebuild(const World& world, const std::vector<size_t>& indices) {
+    rebuildFrom(world, indices.size(), [&](size_t k) { return indices[k]; });
+}
+
+void SpatialGrid::buildCells() {
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.cell < b.cell || (a.cell == b.cell && a.index < b.index);
+    });
+
+    for (size_t begin = 0; begin < entries.size();) {
+        size_t end = begin + 1;
+        while (end < entries.size() && entries[end].cell == entries[begin].cell) ++end;
+        cells.emplace(entries[begin].cell, std::make_pair(begin, end));
+        cellList.push_back(entries[begin].cell);
+        begin = end;
+    }
+}
+
+std::vector<SpatialGrid::Contact> SpatialGrid::findContacts(const std::vector<std::shared_ptr<NPC>>& npcs) {
+    rebuild(npcs);
+
+    std::vector<Contact> contacts;
+    uint64_t tested = 0;
+    forEachCandidatePair([&](size_t i, size_t j) {
+        ++tested;
+        if (npcs[i]->isInRangeForKill(*npcs[j])) contacts.emplace_back(i, j);
+    });
+    countEvent(Counter::PairsTested, tested);
+    countEvent(Counter::ContactsFound, contacts.size());
+    std::sort(contacts.begin(), contacts.end());
+    return contacts;
+}
+
+void SpatialGrid::gatherPositions(const World& world, size_t begin, size_t end) {
+    for (size_t e = begin; e < end; ++e) {
+        sortedX[e] = world.getX(entries[e].index);
+        sortedY[e] = world.getY(entries[e].index);
+    }
+}
+
+void SpatialGrid::scanCells(const World& world, size_t firstCell, size_t lastCell, std::vector<Contact>& out) const {
+    // The lower index is the attacker, so its kill distance decides the pair.
+    // The block is tested with the distance of entry a; pairs where the other
+    // NPC has the lower index and a different distance are rechecked.
+    const int* kill = world.killDistanceData();
+    uint64_t tested = 0;
+    forEachCandidateBlock([&](size_t a, size_t begin, size_t end) {
+        const size_t i = entries[a].index;
+        for (size_t b = begin; b < end; b += 64) {
+            const size_t n = std::min<size_t>(64, end - b);
+            tested += n;
+            uint64_t hits = rangeMask(sortedX[a], sortedY[a], &sortedX[b], &sortedY[b], n, kill[i]);
+            for (size_t k = 0; k < n; ++k) {
+                const size_t j = entries[b + k].index;
+                const bool hit = (hits >> k) & 1;
+                if (i < j) {
+                    if (hit) out.emplace_back(i, j);
+                } else if (kill[j] == kill[i] ? hit : world.isInRangeForKill(j, i)) {
+                    out.emplace_back(j, i);
+                }
+            }
+        }
+    }, firstCell, lastCell);
+    countEvent(Counter::PairsTested, tested);
+}
+
+std::vector<SpatialGrid::Contact> SpatialGrid::findContacts(const World& world) {
+    rebuild(world);
+    sortedX.resize(entries.size());
+    sortedY.resize(entries.size());
+    gatherPositions(world, 0, entries.size());
+
+    std::vector<Contact> contacts;
+    scanCells(world, 0, cellList.size(), contacts);
+    countEvent(Counter::ContactsFound, contacts.size());
+    std::sort(contacts.begin(), contacts.end());
+    return contacts;
+}
+
+std::vector<SpatialGrid::Contact> SpatialGrid::findContacts(const World& world, ThreadPool& pool) {
+    const size_t grain = 4096;
+
+    rebuild(world);
+    sortedX.resize(entries.size());
+    sortedY.resize(entries.size());
+    pool.parallelFor(0, entries.size(), grain, [&](size_t begin, size_t end) {
+        gatherPositions(world, begin, end);
+    });
+
+    const size_t cellGrain = 256;
+    std::vector<std::vector<Contact>> parts((cellList.size() + cellGrain - 1) / cellGrain);
+    pool.parallelFor(0, cellList.size(), cellGrain, [&](size_t begin, size_t end) {
+        scanCells(world, begin, end, parts[begin / cellGrain]);
+    });
+
+    std::vector<Contact> contacts;
+    for (auto& part : parts) {
+        contacts.insert(contacts.end(), part.begin(), part.end());
+    }
+    countEvent(Counter::ContactsFound, contacts.size());
+    std::sort(contacts.begin(), contacts.end());
+    return contacts;
+}
+
+std::vector<SpatialGrid::Contact> SpatialGrid::findContacts(const World& world, const std::vector<size_t>& indices) {
+    rebuild(world, indices);
+    sortedX.resize(entries.size());
+    sortedY.resize(entries.size());
+    gatherPositions(world, 0, entries.size());
+
+    std::vector<Contact> contacts;
+    scanCells(world, 0, cellList.size(), contacts);
+    std::sort(contacts.begin(), contacts.end());
+    return contacts;
+}
@@ -0,0 +1,86 @@
+#include "../include/thread_pool.hpp"
+
+namespace {
+
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping.store(true);
+    }
+    sleepCV.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+size_t ThreadPool::selfIndex() const {
+    return currentPool == this ? currentIndex : queues.size();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t target = currentPool == this ? currentIndex : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    pending.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mtx);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCV.notify_one();
+}
+
+bool ThreadPool::tryRunOne(size_t self) {
+    std::function<void()> task;
+
+    if (self < queues.size()) {
+        std::lock_guard<std::mutex> lock(queues[self]->mtx);
+        if (!queues[self]->tasks.empty()) {
+            task = std::move(queues[self]->tasks.back());
+            queues[self]->tasks.pop_back();
+        }
+    }
+
+    for (size_t k = 1; !task && k <= queues.size(); ++k) {
+        size_t victim = (self + k) % queues.size();
+        std::lock_guard<std::mutex> lock(queues[victim]->mtx);
+        if (!queues[victim]->tasks.empty()) {
+            task = std::move(queues[victim]->tasks.front());
+            queues[victim]->tasks.pop_front();
+        }
+    }
+
+    if (!task) return false;
+    pending.fetch_sub(1, std::memory_order_acq_rel);
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t self) {
+    currentPool = this;
+    currentIndex = self;
+
+    while (true) {
+        if (tryRunOne(self)) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCV.wait(lock, [this]() { return stopping.load() || pending.load() > 0; });
+        if (stopping.load() && pending.load() == 0) return;
+    }
+}
@@ -0,0 +1,177 @@
+#include "../include/tiles.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+
+namespace {
+
+static_assert(kSpeciesCount <= 32, "species masks are 32 bits wide");
+
+constexpr uint32_t speciesBit(NpcType type) {
+    return uint32_t{1} << static_cast<size_t>(type);
+}
+
+// kVictims[a]: mask of the species `a` can attack.
+struct VictimTable {
+    uint32_t masks[kSpeciesCount] = {};
+    constexpr VictimTable() {
+        for (size_t a = 0; a < kSpeciesCount; ++a) {
+            for (size_t t = 0; t < kSpeciesCount; ++t) {
+                if (kCanKill[a][t]) masks[a] |= uint32_t{1} << t;
+            }
+        }
+    }
+};
+
+constexpr VictimTable kVictims;
+
+} // namespace
+
+TileDecomposition::TileDecomposition(int mapSizeX, int mapSizeY, int tileSize, int halo)
+    : tileSize(std::max({1, tileSize, halo})),
+      halo(std::max(0, halo)),
+      cols(std::max(1, (mapSizeX + this->tileSize - 1) / this->tileSize)),
+      rows(std::max(1, (mapSizeY + this->tileSize - 1) / this->tileSize)),
+      tiles(static_cast<size_t>(cols) * rows) {
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            Tile& tile = tiles[static_cast<size_t>(r) * cols + c];
+            tile.x0 = c * this->tileSize;
+            tile.y0 = r * this->tileSize;
+            tile.x1 = tile.x0 + this->tileSize;
+            tile.y1 = tile.y0 + this->tileSize;
+        }
+    }
+}
+
+size_t TileDecomposition::tileOf(int x, int y) const {
+    int c = x / tileSize, r = y / tileSize;
+    c = c < 0 ? 0 : (c >= cols ? cols - 1 : c);
+    r = r < 0 ? 0 : (r >= rows ? rows - 1 : r);
+    return static_cast<size_t>(r) * cols + c;
+}
+
+void TileDecomposition::assign(const World& world) {
+    for (Tile& tile : tiles) tile.owned.clear();
+    for (size_t i = 0; i < world.size(); ++i) {
+        if (world.isAlive(i)) tiles[tileOf(world.getX(i), world.getY(i))].owned.push_back(i);
+    }
+}
+
+void TileDecomposition::move(World& world, ThreadPool& pool) {
+    pool.parallelFor(0, tiles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            for (size_t i : tiles[t].owned) world.moveRandomly(i);
+        }
+    });
+}
+
+void TileDecomposition::migrate(const World& world, ThreadPool& pool) {
+    // Each tile splits its own list; arrivals are then appended tile by tile
+    // so no list is written from two threads.
+    pool.parallelFor(0, tiles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            Tile& tile = tiles[t];
+            tile.leaving.clear();
+            size_t kept = 0;
+            for (size_t i : tile.owned) {
+                if (!world.isAlive(i)) continue;
+                if (tileOf(world.getX(i), world.getY(i)) == t) {
+                    tile.owned[kept++] = i;
+                } else {
+                    tile.leaving.push_back(i);
+                }
+            }
+            tile.owned.resize(kept);
+        }
+    });
+
+    for (Tile& tile : tiles) {
+        for (size_t i : tile.leaving) {
+            tiles[tileOf(world.getX(i), world.getY(i))].owned.push_back(i);
+        }
+        migrations += tile.leaving.size();
+        tile.leaving.clear();
+    }
+}
+
+void TileDecomposition::gatherGhosts(const World& world, size_t t) {
+    // Tiles are never narrower than the halo, so ghosts only come from the
+    // eight neighbours.
+    Tile& tile = tiles[t];
+    tile.scratch.assign(tile.owned.begin(), tile.owned.end());
+
+    const int c = static_cast<int>(t % cols), r = static_cast<int>(t / cols);
+    const int gx0 = tile.x0 - halo, gy0 = tile.y0 - halo;
+    const int gx1 = tile.x1 + halo, gy1 = tile.y1 + halo;
+    for (int nr = std::max(0, r - 1); nr <= std::min(rows - 1, r + 1); ++nr) {
+        for (int nc = std::max(0, c - 1); nc <= std::min(cols - 1, c + 1); ++nc) {
+            if (nr == r && nc == c) continue;
+            for (size_t i : tiles[static_cast<size_t>(nr) * cols + nc].owned) {
+                const int x = world.getX(i), y = world.getY(i);
+                if (x >= gx0 && x < gx1 && y >= gy0 && y < gy1) tile.scratch.push_back(i);
+            }
+        }
+    }
+}
+
+bool TileDecomposition::canFight(size_t t) const {
+    // Neighbour masks cover whole tiles, a superset of the ghost border, so
+    // a tile is only put to sleep when no fight is possible.
+    const int c = static_cast<int>(t % cols), r = static_cast<int>(t / cols);
+    uint32_t nearby = 0;
+    for (int nr = std::max(0, r - 1); nr <= std::min(rows - 1, r + 1); ++nr) {
+        for (int nc = std::max(0, c - 1); nc <= std::min(cols - 1, c + 1); ++nc) {
+            nearby |= tiles[static_cast<size_t>(nr) * cols + nc].species;
+        }
+    }
+    for (size_t a = 0; a < kSpeciesCount; ++a) {
+        if ((tiles[t].species >> a & 1) && (kVictims.masks[a] & nearby)) return true;
+    }
+    return false;
+}
+
+std::vector<SpatialGrid::Contact> TileDecomposition::findContacts(const World& world, ThreadPool& pool) {
+    if (sleeping) {
+        pool.parallelFor(0, tiles.size(), 64, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; ++t) {
+                uint32_t mask = 0;
+                for (size_t i : tiles[t].owned) mask |= speciesBit(world.getTypeId(i));
+                tiles[t].species = mask;
+            }
+        });
+    }
+
+    pool.parallelFor(0, tiles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            Tile& tile = tiles[t];
+            tile.contacts.clear();
+            tile.active = !tile.owned.empty() && (!sleeping || canFight(t));
+            if (!tile.active) continue;
+            gatherGhosts(world, t);
+            for (const SpatialGrid::Contact& contact : tile.grid.findContacts(world, tile.scratch)) {
+                const auto [attacker, target] = contact;
+                if (tileOf(world.getX(attacker), world.getY(attacker)) != t) continue;
+                if (sleeping && !canAttack(world.getTypeId(attacker), world.getTypeId(target))) continue;
+                tile.contacts.push_back(contact);
+            }
+        }
+    });
+
+    std::vector<SpatialGrid::Contact> contacts;
+    activeTiles = 0;
+    for (const Tile& tile : tiles) {
+        contacts.insert(contacts.end(), tile.contacts.begin(), tile.contacts.end());
+        activeTiles += tile.active;
+    }
+    activeTileScans += activeTiles;
+    tileScans += tiles.size();
+    countEvent(Counter::TilesActive, activeTiles);
+    countEvent(Counter::TilesDormant, tiles.size() - activeTiles);
+    countEvent(Counter::ContactsFound, contacts.size());
+    std::sort(contacts.begin(), contacts.end());
+    return contacts;
+}
+
+double TileDecomposition::getActiveFraction() const {
+    return tileScans ? static_cast<double>(activeTileScans) / tileScans : 0.0;
+}
@@ -0,0 +1,94 @@
+#include "../include/timing_wheel.hpp"
+#include <algorithm>
+
+void TimingWheel::place(const Event& event) {
+    const uint64_t delta = event.due - now;
+    int level = 0;
+    while (level + 1 < kLevels && delta >= uint64_t{1} << (kLevelBits * (level + 1))) ++level;
+    slots[level][(event.due >> (kLevelBits * level)) & (kSlots - 1)].push_back(event);
+}
+
+void TimingWheel::schedule(uint64_t payload, uint64_t due) {
+    place({std::max(due, now + 1), payload});
+    ++pending;
+}
+
+void TimingWheel::advance(std::vector<uint64_t>& fired) {
+    ++now;
+
+    // Higher levels turn over first so their events reach level 0 before
+    // it fires.
+    for (int level = kLevels - 1; level > 0; --level) {
+        const int shift = kLevelBits * level;
+        if ((now & ((uint64_t{1} << shift) - 1)) != 0) continue;
+        auto& slot = slots[level][(now >> shift) & (kSlots - 1)];
+        cascading.swap(slot);
+        for (const Event& event : cascading) place(event);
+        cascading.clear();
+    }
+
+    auto& slot = slots[0][now & (kSlots - 1)];
+    for (const Event& event : slot) fired.push_back(event.payload);
+    pending -= slot.size();
+    slot.clear();
+}
+
+void RateScheduler::setRate(size_t npc, UpdateRate rate) {
+    rates[npc] = {std::max<uint32_t>(1, rate.moveEvery), std::max<uint32_t>(1, rate.attackEvery)};
+}
+
+void RateScheduler::scheduleAll() {
+    for (size_t i = 0; i < world.size(); ++i) {
+        if (world.isAlive(i)) add(i);
+    }
+}
+
+void RateScheduler::add(size_t npc) {
+    if (rates.size() < world.size()) {
+        rates.resize(world.size());
+        attackTick.resize(world.size(), ~uint64_t{0});
+    }
+    setRate(npc, speciesRates[static_cast<size_t>(world.getTypeId(npc))]);
+    attackTick[npc] = ~uint64_t{0};
+
+    const NpcHandle handle = world.handle(npc);
+    const uint64_t next = world.getTick() + 1;
+    moveWheel.schedule(handle.raw(), next + npc % rates[npc].moveEvery);
+    attackWheel.schedule(handle.raw(), next + npc % rates[npc].attackEvery);
+}
+
+void RateScheduler::tick(ThreadPool& pool) {
+    world.beginTick();
+    const uint64_t now = world.getTick();
+
+    firedMoves.clear();
+    firedAttacks.clear();
+    while (moveWheel.getNow() < now) moveWheel.advance(firedMoves);
+    while (attackWheel.getNow() < now) attackWheel.advance(firedAttacks);
+
+    moves.clear();
+    for (uint64_t payload : firedMoves) {
+        const size_t i = world.resolve(NpcHandle::fromRaw(payload));
+        if (i == World::kNoSlot || !world.isAlive(i)) continue;
+        moves.push_back(i);
+        moveWheel.schedule(payload, now + rates[i].moveEvery);
+    }
+    attacksDue = 0;
+    for (uint64_t payload : firedAttacks) {
+        const size_t i = world.resolve(NpcHandle::fromRaw(payload));
+        if (i == World::kNoSlot || !world.isAlive(i)) continue;
+        attackTick[i] = now;
+        ++attacksDue;
+        attackWheel.schedule(payload, now + rates[i].attackEvery);
+    }
+
+    pool.parallelFor(0, moves.size(), 4096, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) world.moveRandomly(moves[k]);
+    });
+}
+
+void RateScheduler::filterContacts(std::vector<SpatialGrid::Contact>& contacts) const {
+    contacts.erase(std::remove_if(contacts.begin(), contacts.end(),
+                                  [&](const SpatialGrid::Contact& c) { return !readyToAttack(c.first); }),
+                   contacts.end());
+}
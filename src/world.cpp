@@ -0,0 +1,269 @@
+#include "../include/world.hpp"
+#include "../include/event_bus.hpp"
+#include "../include/range_kernel.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+NpcType NpcRef::typeId() const { return world->getTypeId(index); }
+std::string NpcRef::getType() const { return typeName(world->getTypeId(index)); }
+std::string_view NpcRef::getName() const { return world->getName(index); }
+int NpcRef::getX() const { return world->getX(index); }
+int NpcRef::getY() const { return world->getY(index); }
+bool NpcRef::isAlive() const { return world->isAlive(index); }
+void NpcRef::kill() { world->kill(index); }
+void NpcRef::moveRandomly() { world->moveRandomly(index); }
+bool NpcRef::isInRangeForKill(const NpcRef& other) const { return world->isInRangeForKill(index, other.index); }
+FightResult NpcRef::fight(const NpcRef& other) { return world->fight(index, other.index); }
+std::shared_ptr<NPC> NpcRef::toNpc() const { return world->toNpc(index); }
+
+size_t World::acquireSlot() {
+    if (freeSlots.empty() && pendingDead.load(std::memory_order_relaxed) != 0) {
+        for (size_t i = x.size(); i-- > 0;) {
+            if (!alive[i]) freeSlots.push_back(static_cast<uint32_t>(i));
+        }
+        pendingDead.store(0, std::memory_order_relaxed);
+    }
+    if (!freeSlots.empty()) {
+        const size_t i = freeSlots.back();
+        freeSlots.pop_back();
+        ++generation[i];
+        return i;
+    }
+    if (x.size() >= NpcHandle::kMaxSlots) throw std::length_error("World is limited to 2^32 - 1 NPC slots");
+    return x.size();
+}
+
+size_t World::add(NpcType t, std::string_view name, int px, int py) {
+    const SpeciesInfo& info = species(t);
+    const uint32_t nameId = nameTable.intern(name);
+    const size_t i = acquireSlot();
+    if (i == x.size()) {
+        x.push_back(px);
+        y.push_back(py);
+        alive.push_back(1);
+        type.push_back(t);
+        moveDistance.push_back(info.moveDistance);
+        killDistance.push_back(info.killDistance);
+        nameIds.push_back(nameId);
+        claims.emplace_back(0);
+        generation.push_back(0);
+    } else {
+        x[i] = px;
+        y[i] = py;
+        alive[i] = 1;
+        type[i] = t;
+        moveDistance[i] = info.moveDistance;
+        killDistance[i] = info.killDistance;
+        nameIds[i] = nameId;
+    }
+    if (occupancy) occupancy->add(t, px, py);
+    if (events && events->wants(EventType::Spawn)) {
+        WorldEvent event;
+        event.tick = tick;
+        event.type = EventType::Spawn;
+        event.npcType = t;
+        event.npc = static_cast<uint32_t>(i);
+        event.x = px;
+        event.y = py;
+        event.npcName = getName(i);
+        events->publish(event);
+    }
+    return i;
+}
+
+size_t World::add(const NPC& npc) {
+    size_t i = add(npc.typeId(), npc.getName(), npc.getX(), npc.getY());
+    if (!npc.isAlive()) kill(i);
+    return i;
+}
+
+void World::reserve(size_t count) {
+    x.reserve(count);
+    y.reserve(count);
+    alive.reserve(count);
+    type.reserve(count);
+    moveDistance.reserve(count);
+    killDistance.reserve(count);
+    nameIds.reserve(count);
+    generation.reserve(count);
+}
+
+void World::assign(int mapX, int mapY, size_t count, const int* xs, const int* ys,
+                   const uint8_t* aliveFlags, const NpcType* types, std::vector<std::string> npcNames) {
+    npcNames.resize(count);
+    std::vector<std::string_view> views(npcNames.begin(), npcNames.end());
+    assign(mapX, mapY, count, xs, ys, aliveFlags, types, views.data());
+}
+
+void World::assign(int mapX, int mapY, size_t count, const int* xs, const int* ys,
+                   const uint8_t* aliveFlags, const NpcType* types, const std::string_view* npcNames) {
+    assignColumns(mapX, mapY, count, xs, ys, aliveFlags, types);
+    nameTable.clear();
+    nameTable.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        nameIds[i] = nameTable.intern(npcNames[i]);
+    }
+}
+
+void World::assign(int mapX, int mapY, size_t count, const int* xs, const int* ys,
+                   const uint8_t* aliveFlags, const NpcType* types, const std::string_view* npcNames, ThreadPool& pool) {
+    assignColumns(mapX, mapY, count, xs, ys, aliveFlags, types);
+    nameTable.assign(npcNames, count, nameIds.data(), pool);
+}
+
+void World::assignColumns(int mapX, int mapY, size_t count, const int* xs, const int* ys,
+                          const uint8_t* aliveFlags, const NpcType* types) {
+    if (count > NpcHandle::kMaxSlots) throw std::length_error("World is limited to 2^32 - 1 NPC slots");
+    mapSizeX = mapX;
+    mapSizeY = mapY;
+    x.assign(xs, xs + count);
+    y.assign(ys, ys + count);
+    alive.assign(aliveFlags, aliveFlags + count);
+    type.assign(types, types + count);
+    nameIds.resize(count);
+
+    moveDistance.resize(count);
+    killDistance.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        moveDistance[i] = species(type[i]).moveDistance;
+        killDistance[i] = species(type[i]).killDistance;
+    }
+
+    claims.clear();
+    for (size_t i = 0; i < count; ++i) {
+        claims.emplace_back(0);
+    }
+    generation.assign(count, 0);
+    freeSlots.clear();
+    pendingDead.store(count - aliveCount(), std::memory_order_relaxed);
+    if (occupancy) trackOccupancy(occupancy->getCellSize());
+}
+
+void World::setMapSize(int sizeX, int sizeY) {
+    mapSizeX = sizeX;
+    mapSizeY = sizeY;
+    if (occupancy) trackOccupancy(occupancy->getCellSize());
+}
+
+void World::kill(size_t i) {
+    if (!alive[i]) return;
+    alive[i] = 0;
+    pendingDead.fetch_add(1, std::memory_order_relaxed);
+    if (occupancy) occupancy->remove(type[i], x[i], y[i]);
+}
+
+void World::trackOccupancy(int cellSize) {
+    occupancy = std::make_unique<OccupancyGrid>(mapSizeX, mapSizeY, cellSize);
+    for (size_t i = 0; i < x.size(); ++i) {
+        if (alive[i]) occupancy->add(type[i], x[i], y[i]);
+    }
+}
+
+size_t World::aliveCount() const {
+    return static_cast<size_t>(std::count(alive.begin(), alive.end(), uint8_t{1}));
+}
+
+void World::moveRandomly(size_t i) {
+    if (!alive[i]) return;
+    CounterRng rng(seed, i, tick, RngStream::Move);
+
+    int newX = x[i] + rng.uniform(-moveDistance[i], moveDistance[i]);
+    int newY = y[i] + rng.uniform(-moveDistance[i], moveDistance[i]);
+
+    newX = std::max(0, std::min(newX, mapSizeX - 1));
+    newY = std::max(0, std::min(newY, mapSizeY - 1));
+    if (occupancy) occupancy->move(type[i], x[i], y[i], newX, newY);
+    x[i] = newX;
+    y[i] = newY;
+    if (events && events->wants(EventType::Move)) {
+        WorldEvent event;
+        event.tick = tick;
+        event.type = EventType::Move;
+        event.npcType = type[i];
+        event.npc = static_cast<uint32_t>(i);
+        event.x = newX;
+        event.y = newY;
+        event.npcName = getName(i);
+        events->publish(event);
+    }
+}
+
+void World::moveRange(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        moveRandomly(i);
+    }
+}
+
+void World::moveAll() {
+    beginTick();
+    moveRange(0, x.size());
+}
+
+bool World::isInRangeForKill(size_t attacker, size_t target) const {
+    if (!alive[attacker] || !alive[target]) return false;
+    return inRange(x[attacker], y[attacker], x[target], y[target], killDistance[attacker]);
+}
+
+FightResult World::fight(size_t attacker, size_t defender) {
+    if (!alive[attacker] || !alive[defender]) return FightResult::NoFight;
+    if (!canAttack(type[attacker], type[defender])) return FightResult::NoFight;
+
+    CounterRng dice(seed, attacker, tick, RngStream::Dice, defender);
+    int attackPower = dice.uniform(1, species(type[attacker]).diceSides);
+    int defensePower = dice.uniform(1, species(type[defender]).diceSides);
+
+    if (attackPower > defensePower) {
+        kill(defender);
+        publishFight(attacker, defender, true);
+        return FightResult::Won;
+    }
+    publishFight(attacker, defender, false);
+    return FightResult::Lost;
+}
+
+bool World::tryClaim(size_t a, size_t b) {
+    size_t first = std::min(a, b);
+    size_t second = std::max(a, b);
+    uint8_t expected = 0;
+    if (!claims[first].compare_exchange_strong(expected, 1, std::memory_order_acquire)) return false;
+    expected = 0;
+    if (!claims[second].compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+        claims[first].store(0, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void World::release(size_t a, size_t b) {
+    claims[a].store(0, std::memory_order_release);
+    claims[b].store(0, std::memory_order_release);
+}
+
+void World::publishFight(size_t attacker, size_t defender, bool win) const {
+    if (!events) return;
+    WorldEvent event;
+    event.tick = tick;
+    event.type = EventType::Fight;
+    event.npcType = type[attacker];
+    event.otherType = type[defender];
+    event.win = win;
+    event.npc = static_cast<uint32_t>(attacker);
+    event.other = static_cast<uint32_t>(defender);
+    event.x = x[attacker];
+    event.y = y[attacker];
+    event.otherX = x[defender];
+    event.otherY = y[defender];
+    event.npcName = getName(attacker);
+    event.otherName = getName(defender);
+    events->publish(event);
+    if (win) {
+        event.type = EventType::Kill;
+        events->publish(event);
+    }
+}
+
+std::shared_ptr<NPC> World::toNpc(size_t i) const {
+    auto npc = NPC::create(type[i], std::string(getName(i)), x[i], y[i]);
+    if (!alive[i]) npc->kill();
+    return npc;
+}
@@ -0,0 +1,39 @@
+#include "../include/world_frame.hpp"
+#include <algorithm>
+
+size_t WorldFrame::aliveCount() const {
+    return static_cast<size_t>(std::count_if(alive.begin(), alive.end(), [](uint8_t a) { return a != 0; }));
+}
+
+void FrameBuffer::publish(const World& world) {
+    // `back` is only shared if a reader kept the frame it was the front of.
+    // Seeing a count of one, the fence orders the reader's last accesses
+    // before our writes.
+    if (!back || back.use_count() > 1) {
+        back = std::make_shared<WorldFrame>();
+        ++allocations;
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    WorldFrame& frame = *back;
+    const size_t n = world.size();
+    frame.tick = world.getTick();
+    frame.mapSizeX = world.getMapSizeX();
+    frame.mapSizeY = world.getMapSizeY();
+    frame.x.assign(world.xData(), world.xData() + n);
+    frame.y.assign(world.yData(), world.yData() + n);
+    frame.alive.assign(world.aliveData(), world.aliveData() + n);
+    frame.type.assign(world.typeData(), world.typeData() + n);
+    frame.generation.assign(world.generationData(), world.generationData() + n);
+    if (const OccupancyGrid* grid = world.getOccupancy()) {
+        if (!frame.occupancy) frame.occupancy = std::make_unique<OccupancyGrid>(1, 1, 1);
+        frame.occupancy->copyFrom(*grid);
+    } else {
+        frame.occupancy.reset();
+    }
+
+    std::shared_ptr<const WorldFrame> previous = std::atomic_exchange(&front, std::shared_ptr<const WorldFrame>(back));
+    back = std::const_pointer_cast<WorldFrame>(previous);
+    ++published;
+}
@@ -1,8 +1,42 @@
 #include "../include/npc_system.hpp"
+#include "../include/battle.hpp"
+#include "../include/checkpoint.hpp"
+#include "../include/console_reporter.hpp"
+#include "../include/event_bus.hpp"
+#include "../include/fight_log.hpp"
+#include "../include/map_view.hpp"
+#include "../include/metrics.hpp"
+#include "../include/name_table.hpp"
+#include "../include/range_kernel.hpp"
+#include "../include/replay.hpp"
+#include "../include/rng.hpp"
+#include "../include/scenario.hpp"
+#include "../include/scheduler.hpp"
+#include "../include/snapshot.hpp"
+#include "../include/spatial_grid.hpp"
+#include "../include/thread_pool.hpp"
+#include "../include/tiles.hpp"
+#include "../include/timing_wheel.hpp"
+#include "../include/world.hpp"
+#include "../include/world_frame.hpp"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <set>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 
 
@@ -88,6 +122,27 @@ TEST(FightTest, DuckDoesNotKillAnyone) {
     EXPECT_TRUE(duck->isAlive());
 }
 
+TEST(SpeciesTest, TableDrivesDistancesAndFightMatrix) {
+    for (size_t a = 0; a < kSpeciesCount; ++a) {
+        const NpcType attackerType = static_cast<NpcType>(a);
+        auto probe = NPC::create(attackerType, "probe", 0, 0);
+        EXPECT_EQ(probe->getType(), kSpecies[a].name);
+        EXPECT_EQ(probe->getMoveDistance(), kSpecies[a].moveDistance);
+        EXPECT_EQ(probe->getKillDistance(), kSpecies[a].killDistance);
+
+        for (size_t t = 0; t < kSpeciesCount; ++t) {
+            const NpcType targetType = static_cast<NpcType>(t);
+            if (canAttack(attackerType, targetType)) continue;
+            auto attacker = NPC::create(attackerType, "a", 0, 0);
+            auto target = NPC::create(targetType, "t", 0, 0);
+            EXPECT_FALSE(attacker->fight(*target));
+            EXPECT_TRUE(target->isAlive());
+        }
+    }
+    EXPECT_EQ(maxKillDistance(), 20);
+    EXPECT_FALSE(canAttackAnyone(NpcType::Duck));
+}
+
 
 class TestObserver : public IFightObserver {
 public:
@@ -105,5 +160,1247 @@ public:
 };
 
 
+TEST(SpatialGridTest, ContactsMatchBruteForce) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> coord(0, 199);
+    std::uniform_int_distribution<> type(0, 2);
+
+    std::vector<std::shared_ptr<NPC>> npcs;
+    for (int i = 0; i < 500; ++i) {
+        int x = coord(gen);
+        int y = coord(gen);
+        switch (type(gen)) {
+            case 0: npcs.push_back(std::make_shared<Bear>("Bear" + std::to_string(i), x, y)); break;
+            case 1: npcs.push_back(std::make_shared<Duck>("Duck" + std::to_string(i), x, y)); break;
+            case 2: npcs.push_back(std::make_shared<Desman>("Desman" + std::to_string(i), x, y)); break;
+        }
+        if (i % 7 == 0) npcs.back()->kill();
+    }
+
+    std::vector<std::pair<size_t, size_t>> expected;
+    for (size_t i = 0; i < npcs.size(); ++i) {
+        for (size_t j = i + 1; j < npcs.size(); ++j) {
+            if (npcs[i]->isInRangeForKill(*npcs[j])) expected.emplace_back(i, j);
+        }
+    }
+
+    SpatialGrid grid;
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(grid.findContacts(npcs), expected);
+}
+
+TEST(WorldTest, PackedStorageMatchesNpcApi) {
+    World world(100, 100);
+    auto bear = std::make_shared<Bear>("Bear", 0, 0);
+    auto desman = std::make_shared<Desman>("Desman", 15, 0);
+
+    size_t b = world.add(*bear);
+    size_t d = world.add(NpcType::Desman, "Desman", 15, 0);
+
+    EXPECT_EQ(world[d].getType(), desman->getType());
+    EXPECT_EQ(world.getKillDistance(d), desman->getKillDistance());
+    EXPECT_EQ(world[b].isInRangeForKill(world[d]), bear->isInRangeForKill(*desman));
+    EXPECT_EQ(world[d].isInRangeForKill(world[b]), desman->isInRangeForKill(*bear));
+
+    for (int i = 0; i < 100; ++i) world.moveAll();
+    EXPECT_GE(world.getX(b), 0);
+    EXPECT_LT(world.getX(b), 100);
+    EXPECT_GE(world.getY(d), 0);
+    EXPECT_LT(world.getY(d), 100);
+}
+
+TEST(WorldTest, SpatialGridOnWorldMatchesBruteForce) {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> coord(0, 149);
+    std::uniform_int_distribution<> type(0, 2);
+
+    World world(150, 150);
+    for (int i = 0; i < 400; ++i) {
+        world.add(static_cast<NpcType>(type(gen)), "npc" + std::to_string(i), coord(gen), coord(gen));
+    }
+
+    std::vector<std::pair<size_t, size_t>> expected;
+    for (size_t i = 0; i < world.size(); ++i) {
+        for (size_t j = i + 1; j < world.size(); ++j) {
+            if (world.isInRangeForKill(i, j)) expected.emplace_back(i, j);
+        }
+    }
+
+    SpatialGrid grid;
+    EXPECT_EQ(grid.findContacts(world), expected);
+}
+
+TEST(RangeKernelTest, AllPathsMatchHypot) {
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<> coord(0, 60);
+
+    std::vector<int> xs(61), ys(61);
+    for (int trial = 0; trial < 200; ++trial) {
+        for (size_t k = 0; k < xs.size(); ++k) {
+            xs[k] = coord(gen);
+            ys[k] = coord(gen);
+        }
+        int ax = coord(gen);
+        int ay = coord(gen);
+        int distance = trial % 25;
+
+        uint64_t expected = 0;
+        for (size_t k = 0; k < xs.size(); ++k) {
+            if (std::hypot(ax - xs[k], ay - ys[k]) <= distance) expected |= uint64_t{1} << k;
+        }
+
+        for (RangeKernelIsa isa : {RangeKernelIsa::Scalar, RangeKernelIsa::SSE2, RangeKernelIsa::AVX2}) {
+            EXPECT_EQ(rangeMaskWith(isa, ax, ay, xs.data(), ys.data(), xs.size(), distance), expected)
+                << rangeKernelName(isa);
+        }
+    }
+}
+
+TEST(RangeKernelTest, IsCloseUsesSquaredDistance) {
+    auto a = std::make_shared<Duck>("A", 0, 0);
+    auto b = std::make_shared<Duck>("B", 30000, 40000);
+
+    EXPECT_TRUE(a->is_close(b, 50000));
+    EXPECT_FALSE(a->is_close(b, 49999));
+}
+
+TEST(RngTest, CounterRngIsReproducibleAndInRange) {
+    CounterRng a(99, 5, 7, RngStream::Dice);
+    CounterRng b(99, 5, 7, RngStream::Dice);
+    CounterRng c(99, 5, 8, RngStream::Dice);
+
+    bool differs = false;
+    for (int i = 0; i < 1000; ++i) {
+        int va = a.uniform(1, 6);
+        EXPECT_EQ(va, b.uniform(1, 6));
+        EXPECT_GE(va, 1);
+        EXPECT_LE(va, 6);
+        differs |= va != c.uniform(1, 6);
+    }
+    EXPECT_TRUE(differs);
+}
+
+TEST(RngTest, WorldRunIsReproducibleFromSeed) {
+    auto run = [](uint64_t seed) {
+        World world(200, 200, seed);
+        for (int i = 0; i < 60; ++i) {
+            CounterRng rng(seed, static_cast<uint64_t>(i), 0, RngStream::Spawn);
+            world.add(static_cast<NpcType>(rng.uniform(0, 2)), "npc", rng.uniform(0, 199), rng.uniform(0, 199));
+        }
+        SpatialGrid grid;
+        for (int tick = 0; tick < 20; ++tick) {
+            world.moveAll();
+            for (const auto& [i, j] : grid.findContacts(world)) world.fight(i, j);
+        }
+        std::vector<int> state;
+        for (size_t i = 0; i < world.size(); ++i) {
+            state.push_back(world.isAlive(i) ? world.getX(i) * 1000 + world.getY(i) : -1);
+        }
+        return state;
+    };
+
+    EXPECT_EQ(run(1234), run(1234));
+    EXPECT_NE(run(1234), run(4321));
+}
+
+TEST(SchedulerTest, ParallelContactsMatchSerial) {
+    World world(300, 300, 11);
+    for (int i = 0; i < 3000; ++i) {
+        CounterRng rng(11, static_cast<uint64_t>(i), 0, RngStream::Spawn);
+        world.add(static_cast<NpcType>(rng.uniform(0, 2)), "npc", rng.uniform(0, 299), rng.uniform(0, 299));
+    }
+
+    ThreadPool pool(4);
+    std::atomic<size_t> moved{0};
+    world.beginTick();
+    pool.parallelFor(0, world.size(), 100, [&](size_t begin, size_t end) {
+        world.moveRange(begin, end);
+        moved += end - begin;
+    });
+    EXPECT_EQ(moved.load(), world.size());
+
+    SpatialGrid serial;
+    SpatialGrid parallel;
+    EXPECT_EQ(parallel.findContacts(world, pool), serial.findContacts(world));
+}
+
+TEST(SchedulerTest, RunsPhasesInOrderEveryTick) {
+    ThreadPool pool(2);
+    TickScheduler scheduler(pool, std::chrono::milliseconds(0));
+    std::vector<int> order;
+
+    scheduler.setPhase(TickPhase::Notify, [&](uint64_t) { order.push_back(3); });
+    scheduler.setPhase(TickPhase::Move, [&](uint64_t) { order.push_back(0); });
+    scheduler.setPhase(TickPhase::ResolveFights, [&](uint64_t) { order.push_back(2); });
+    scheduler.setPhase(TickPhase::DetectContacts, [&](uint64_t) { order.push_back(1); });
+
+    std::atomic<bool> running{true};
+    scheduler.run(running, 3);
+
+    EXPECT_EQ(scheduler.getTick(), 3u);
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3}));
+}
+
+TEST(BattleQueueTest, ConcurrentProducersAndConsumersSeeEveryTask) {
+    BattleQueue queue(1000);
+    EXPECT_EQ(queue.capacity(), 1024u);
+
+    const size_t perProducer = 5000;
+    std::atomic<size_t> popped{0};
+    std::atomic<size_t> sum{0};
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < 2; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t k = 0; k < perProducer; ++k) {
+                while (!queue.tryPush(BattleTask{NpcHandle(p, 0), NpcHandle(k, 0)})) std::this_thread::yield();
+            }
+        });
+    }
+    for (size_t c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            BattleTask task;
+            while (popped.load() < 2 * perProducer) {
+                if (queue.tryPop(task)) {
+                    sum += task.target.index();
+                    ++popped;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(popped.load(), 2 * perProducer);
+    EXPECT_EQ(sum.load(), perProducer * (perProducer - 1));
+    EXPECT_EQ(queue.depth(), 0u);
+}
+
+TEST(BattleQueueTest, WorkersNeverKillTheSameNpcTwice) {
+    World world(10, 10, 21);
+    size_t duck = world.add(NpcType::Duck, "Duck", 5, 5);
+    BattleQueue queue(256);
+    for (int i = 0; i < 100; ++i) {
+        size_t bear = world.add(NpcType::Bear, "Bear" + std::to_string(i), 5, 5);
+        ASSERT_TRUE(queue.tryPush(BattleTask{world.handle(bear), world.handle(duck)}));
+    }
+
+    ThreadPool pool(4);
+    BattleWorkers workers(world, queue, 4);
+    workers.drain(pool);
+
+    EXPECT_EQ(queue.depth(), 0u);
+    EXPECT_FALSE(world.isAlive(duck));
+    EXPECT_EQ(workers.getKills(), 1u);
+    EXPECT_GE(workers.getFights(), 1u);
+}
+
+TEST(BattleQueueTest, CoalescerDeduplicatesFiltersAndDefers) {
+    World world(10, 10, 3);
+    size_t bear = world.add(NpcType::Bear, "Bear", 0, 0);
+    size_t duck = world.add(NpcType::Duck, "Duck", 0, 0);
+    size_t desman = world.add(NpcType::Desman, "Desman", 0, 0);
+    size_t bear2 = world.add(NpcType::Bear, "Bear2", 0, 0);
+
+    BattleQueue queue(2);
+    ContactCoalescer coalescer(queue, Backpressure::Coalesce);
+    coalescer.submit(world, {{bear, duck}, {bear, duck}, {duck, desman}, {bear, bear2}, {bear, desman}, {desman, bear2}});
+
+    EXPECT_EQ(coalescer.getDuplicates(), 1u);
+    EXPECT_EQ(coalescer.getImpossible(), 2u);
+    EXPECT_EQ(coalescer.getQueued(), 2u);
+    EXPECT_EQ(coalescer.getDeferred(), 1u);
+
+    BattleTask task;
+    while (queue.tryPop(task)) {}
+    coalescer.submit(world, {{desman, bear2}});
+    EXPECT_EQ(coalescer.getDuplicates(), 2u);
+    EXPECT_EQ(coalescer.getQueued(), 3u);
+    EXPECT_EQ(coalescer.getDeferred(), 0u);
+    EXPECT_EQ(coalescer.getDropped(), 0u);
+}
+
+TEST(FightLogTest, AsyncRecordsRoundTripToTextFormat) {
+    World world(100, 100, 1);
+    world.add(NpcType::Bear, "Bear0", 53, 96);
+    world.add(NpcType::Duck, "Duck1", 54, 99);
+
+    const std::string path = "fight_log_test.bin";
+    {
+        AsyncFightLog log;
+        ASSERT_TRUE(log.open(path, world));
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 3; ++t) {
+            threads.emplace_back([&log, t]() {
+                for (int k = 0; k < 5000; ++k) {
+                    FightRecord record{};
+                    record.tick = static_cast<uint64_t>(t);
+                    record.attacker = 0;
+                    record.defender = 1;
+                    record.attackerX = 53;
+                    record.attackerY = 96;
+                    record.defenderX = 54;
+                    record.defenderY = 99;
+                    record.attackerType = static_cast<uint8_t>(NpcType::Bear);
+                    record.defenderType = static_cast<uint8_t>(NpcType::Duck);
+                    record.win = k == 0;
+                    log.append(record);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        log.close();
+        EXPECT_EQ(log.getWritten(), 15000u);
+    }
+
+    FightLogReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.getNames().size(), 2u);
+
+    size_t records = 0;
+    std::ostringstream text;
+    FightRecord record;
+    while (reader.next(record)) {
+        ++records;
+        writeTextRecord(text, record, reader);
+    }
+    std::remove(path.c_str());
+
+    EXPECT_EQ(records, 15000u);
+    std::string entry = "\nУбийца --------\n[Bear] Bear0 @ (53, 96)\n[Duck] Duck1 @ (54, 99)\n";
+    EXPECT_EQ(text.str(), entry + entry + entry);
+
+    // A newcomer in the duck's recycled slot is not decoded under its name.
+    world.kill(1);
+    ASSERT_EQ(world.add(NpcType::Duck, "Late", 1, 1), 1u);
+    record.attacker = 0;
+    record.defender = 1;
+    record.attackerGeneration = world.handle(0).generation();
+    record.defenderGeneration = world.handle(1).generation();
+    record.win = 1;
+    text.str("");
+    EXPECT_FALSE(writeTextRecord(text, record, reader));
+    EXPECT_EQ(text.str(), "");
+
+    // A thread alternating between two logs keeps one ring in each.
+    {
+        AsyncFightLog first, second;
+        ASSERT_TRUE(first.open(path, world));
+        ASSERT_TRUE(second.open(path + ".2", world));
+        for (int k = 0; k < 1000; ++k) {
+            first.append(record);
+            second.append(record);
+        }
+        EXPECT_EQ(first.getRings(), 1u);
+        EXPECT_EQ(second.getRings(), 1u);
+        first.close();
+        second.close();
+        EXPECT_EQ(first.getWritten() + second.getWritten(), 2000u);
+        EXPECT_FALSE(first.hasFailed());
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".2").c_str());
+
+    // A log whose header cannot be written fails to open.
+    if (std::filesystem::exists("/dev/full")) {
+        AsyncFightLog full;
+        EXPECT_FALSE(full.open("/dev/full", world));
+        EXPECT_FALSE(full.isOpen());
+    }
+}
+
+TEST(SnapshotTest, BinaryRoundTripAndCorruptionDetection) {
+    World world(500, 400, 77);
+    for (int i = 0; i < 1000; ++i) {
+        CounterRng rng(77, static_cast<uint64_t>(i), 0, RngStream::Spawn);
+        NpcType type = static_cast<NpcType>(rng.uniform(0, 2));
+        world.add(type, typeName(type) + std::to_string(i), rng.uniform(0, 499), rng.uniform(0, 399));
+    }
+    world.kill(3);
+    world.moveAll();
+
+    const std::string path = "snapshot_test.bin";
+    saveSnapshot(world, path);
+
+    World loaded(1, 1);
+    loadSnapshot(loaded, path);
+    EXPECT_EQ(loaded.size(), world.size());
+    EXPECT_EQ(loaded.getMapSizeX(), 500);
+    EXPECT_EQ(loaded.getMapSizeY(), 400);
+    EXPECT_EQ(loaded.getSeed(), 77u);
+    EXPECT_EQ(loaded.getTick(), world.getTick());
+    for (size_t i = 0; i < world.size(); ++i) {
+        ASSERT_EQ(loaded.getX(i), world.getX(i));
+        ASSERT_EQ(loaded.getY(i), world.getY(i));
+        ASSERT_EQ(loaded.isAlive(i), world.isAlive(i));
+        ASSERT_EQ(loaded.getTypeId(i), world.getTypeId(i));
+        ASSERT_EQ(loaded.getName(i), world.getName(i));
+        ASSERT_EQ(loaded.getKillDistance(i), world.getKillDistance(i));
+    }
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(SnapshotHeader) + 5);
+        file.put('\x7f');
+    }
+    EXPECT_THROW(loadSnapshot(loaded, path), std::runtime_error);
+
+    // A count whose section offsets wrap around to fit inside the file is
+    // rejected by the size check, not by luck further on.
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        const uint64_t count = 0x0e38e38e38e38e38;
+        file.seekp(offsetof(SnapshotHeader, count));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    try {
+        loadSnapshot(loaded, path);
+        FAIL() << "wrapped count accepted";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("Truncated snapshot"), std::string::npos) << e.what();
+    }
+    std::remove(path.c_str());
+}
+
+TEST(SnapshotTest, TextExportMatchesNpcSaveFormat) {
+    World world(100, 100);
+    world.add(NpcType::Bear, "Bear1", 1, 2);
+    world.add(NpcType::Desman, "Desman2", 3, 4);
+
+    std::stringstream text;
+    exportText(world, text);
+    EXPECT_EQ(text.str(), "Bear Bear1 1 2\nDesman Desman2 3 4\n");
+
+    World imported(100, 100);
+    importText(imported, text);
+    EXPECT_EQ(imported.size(), 2u);
+    EXPECT_EQ(imported.getName(1), "Desman2");
+    EXPECT_EQ(imported.getTypeId(1), NpcType::Desman);
+}
+
+TEST(SnapshotTest, ParallelTextLoaderMatchesImportAndReportsLines) {
+    const std::string path = "text_loader_test.txt";
+    {
+        std::ofstream os(path);
+        for (int i = 0; i < 150000; ++i) {
+            os << typeName(static_cast<NpcType>(i % 3)) << " npc" << i << " " << i % 997 << " " << i % 991 << "\n";
+            if (i == 70000) os << "\n";
+        }
+    }
+
+    ThreadPool pool(4);
+    World loaded(1000, 1000);
+    loadTextFile(loaded, path, pool);
+    World imported(1000, 1000);
+    std::ifstream is(path);
+    importText(imported, is);
+
+    ASSERT_EQ(loaded.size(), 150000u);
+    ASSERT_EQ(loaded.size(), imported.size());
+    for (size_t i = 0; i < loaded.size(); i += 7) {
+        ASSERT_EQ(loaded.getName(i), imported.getName(i));
+        ASSERT_EQ(loaded.getTypeId(i), imported.getTypeId(i));
+        ASSERT_EQ(loaded.getX(i), imported.getX(i));
+        ASSERT_EQ(loaded.getY(i), imported.getY(i));
+    }
+    EXPECT_EQ(loaded.getMapSizeX(), 1000);
+
+    // Line 120002: the blank line at 70002 shifts every later record by one.
+    {
+        std::ofstream os(path);
+        for (int i = 0; i < 150000; ++i) {
+            if (i == 120000) {
+                os << "Bear broken 12 x3\n";
+            } else {
+                os << "Duck d" << i << " 1 2\n";
+            }
+            if (i == 70000) os << "\n";
+        }
+    }
+    try {
+        loadTextFile(loaded, path, pool);
+        FAIL() << "malformed record accepted";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find(path + ":120002: bad coordinates"), std::string::npos) << e.what();
+    }
+    EXPECT_EQ(loaded.size(), 150000u);
+    std::remove(path.c_str());
+}
+
+TEST(MetricsTest, PhasesCountersAndExportFormats) {
+    if (!NPC_METRICS) GTEST_SKIP() << "built with NPC_METRICS=0";
+    Metrics& metrics = Metrics::global();
+    metrics.reset();
+
+    ThreadPool pool(2);
+    TickScheduler scheduler(pool, std::chrono::milliseconds(0));
+    World world(50, 50, 9);
+    world.add(NpcType::Bear, "Bear", 10, 10);
+    world.add(NpcType::Duck, "Duck", 12, 10);
+    SpatialGrid grid;
+    scheduler.setPhase(TickPhase::DetectContacts, [&](uint64_t) {
+        grid.findContacts(world, pool);
+    });
+    std::atomic<bool> running{true};
+    scheduler.run(running, 3);
+
+    EXPECT_EQ(metrics.get(Counter::Ticks), 3u);
+    EXPECT_EQ(metrics.get(Counter::ContactsFound), 3u);
+    EXPECT_GE(metrics.get(Counter::PairsTested), 3u);
+    EXPECT_EQ(metrics.histogram(Timer::PhaseDetectContacts).count(), 3u);
+    EXPECT_EQ(metrics.histogram(Timer::PhaseMove).count(), 0u);
+
+    LatencyHistogram h;
+    h.record(0);
+    h.record(1000);
+    h.record(1000000);
+    EXPECT_EQ(h.count(), 3u);
+    EXPECT_EQ(h.quantileNs(0.5), 1024u);
+    EXPECT_EQ(h.quantileNs(1.0), 1u << 20);
+
+    std::ostringstream json, prom;
+    metrics.writeJson(json);
+    metrics.writePrometheus(prom);
+    EXPECT_NE(json.str().find("\"contacts_found\": 3"), std::string::npos);
+    EXPECT_NE(json.str().find("\"phase_detect_contacts\": {\"count\": 3"), std::string::npos);
+    EXPECT_NE(prom.str().find("npc_ticks_total 3\n"), std::string::npos);
+    EXPECT_NE(prom.str().find("npc_phase_detect_contacts_seconds_bucket{le=\"+Inf\"} 3\n"), std::string::npos);
+    metrics.reset();
+}
+
+TEST(OccupancyTest, GridFollowsMovesAndDeathsAndViewDiffs) {
+    World world(200, 120, 21);
+    for (int i = 0; i < 300; ++i) {
+        CounterRng rng(21, static_cast<uint64_t>(i), 0, RngStream::Spawn);
+        NpcType type = static_cast<NpcType>(rng.uniform(0, 2));
+        world.add(type, "n" + std::to_string(i), rng.uniform(0, 199), rng.uniform(0, 119));
+    }
+    world.trackOccupancy(10);
+    const OccupancyGrid& grid = *world.getOccupancy();
+    SpatialGrid contacts;
+
+    for (int tick = 0; tick < 10; ++tick) {
+        world.moveAll();
+        for (const auto& [a, b] : contacts.findContacts(world)) world.fight(a, b);
+
+        std::vector<uint32_t> expected(static_cast<size_t>(grid.getCols()) * grid.getRows() * kSpeciesCount, 0);
+        for (size_t i = 0; i < world.size(); ++i) {
+            if (!world.isAlive(i)) continue;
+            size_t cell = static_cast<size_t>(world.getY(i) / 10) * grid.getCols() + world.getX(i) / 10;
+            ++expected[cell * kSpeciesCount + static_cast<size_t>(world.getTypeId(i))];
+        }
+        for (int r = 0; r < grid.getRows(); ++r) {
+            for (int c = 0; c < grid.getCols(); ++c) {
+                for (size_t t = 0; t < kSpeciesCount; ++t) {
+                    size_t cell = static_cast<size_t>(r) * grid.getCols() + c;
+                    ASSERT_EQ(grid.count(c, r, static_cast<NpcType>(t)), expected[cell * kSpeciesCount + t]);
+                }
+            }
+        }
+    }
+
+    World small(30, 20);
+    small.trackOccupancy(10);
+    size_t bear = small.add(NpcType::Bear, "Bear", 5, 5);
+    MapView view(*small.getOccupancy());
+    EXPECT_EQ(view.render(false), "=== MAP x10 @ (0, 0) ===\nB..\n...\n");
+
+    std::string first = view.render(true);
+    EXPECT_EQ(first.rfind("\x1b[H\x1b[2J", 0), 0u);
+    EXPECT_EQ(view.render(true), "\x1b" "7\x1b" "8");
+
+    small.add(NpcType::Duck, "Duck", 25, 15);
+    small.kill(bear);
+    EXPECT_EQ(view.render(true), "\x1b" "7\x1b[2;1H.\x1b[3;3HD\x1b" "8");
+
+    MapView zoomed(*small.getOccupancy(), 2);
+    EXPECT_EQ(zoomed.render(false), "=== MAP x20 @ (0, 0) ===\n.D\n");
+}
+
+TEST(WorldTest, DeadSlotsAreRecycledBehindGenerationalHandles) {
+    World world(100, 100, 5);
+    size_t bear = world.add(NpcType::Bear, "Bear", 0, 0);
+    size_t duck = world.add(NpcType::Duck, "Duck", 0, 0);
+    size_t desman = world.add(NpcType::Desman, "Desman", 0, 0);
+    NpcHandle oldDuck = world.handle(duck);
+    NpcHandle oldDesman = world.handle(desman);
+    EXPECT_EQ(world.resolve(oldDuck), duck);
 
+    BattleQueue queue(2);
+    ContactCoalescer coalescer(queue, Backpressure::Coalesce);
+    coalescer.submit(world, {{bear, duck}, {bear, desman}, {desman, bear}});
+    EXPECT_EQ(coalescer.getDeferred(), 1u);
 
+    world.kill(desman);
+    world.kill(duck);
+    EXPECT_EQ(world.resolve(oldDuck), duck);
+    size_t newcomer = world.add(NpcType::Duck, "Duck", 7, 7);
+    size_t second = world.add(NpcType::Bear, "Late", 9, 9);
+    EXPECT_EQ(newcomer, duck);
+    EXPECT_EQ(second, desman);
+    EXPECT_EQ(world.size(), 3u);
+    EXPECT_EQ(world.resolve(oldDuck), World::kNoSlot);
+    EXPECT_EQ(world.resolve(oldDesman), World::kNoSlot);
+    EXPECT_NE(world.handle(duck), oldDuck);
+    EXPECT_TRUE(world.isAlive(duck));
+    EXPECT_EQ(world.getX(duck), 7);
+
+    // The queued tasks and the deferred one all point at reused slots.
+    ThreadPool pool(2);
+    BattleWorkers workers(world, queue, 2);
+    workers.drain(pool);
+    EXPECT_EQ(workers.getStale(), 2u);
+    EXPECT_EQ(workers.getKills(), 0u);
+    coalescer.submit(world, {});
+    EXPECT_EQ(coalescer.getImpossible(), 1u);
+    EXPECT_EQ(queue.depth(), 0u);
+
+    EXPECT_EQ(world.getName(bear), "Bear");
+    EXPECT_EQ(world.getName(second), "Late");
+    EXPECT_EQ(world.getNameTable().size(), 4u);
+    EXPECT_EQ(world.getName(duck).data(), world.getNameTable().get(1).data());
+
+    // Generations no longer wrap after 256 reuses of a slot.
+    NpcHandle first = world.handle(duck);
+    for (int k = 0; k < 300; ++k) {
+        world.kill(duck);
+        ASSERT_EQ(world.add(NpcType::Duck, "Duck", 1, 1), duck);
+    }
+    EXPECT_EQ(world.resolve(first), World::kNoSlot);
+    EXPECT_EQ(world.handle(duck).generation(), first.generation() + 300);
+    EXPECT_EQ(world.resolve(world.handle(duck)), duck);
+}
+
+TEST(NPCTest, ConcurrentFightsKillOnceAndPositionsStayConsistent) {
+    struct WinCounter : IFightObserver {
+        std::atomic<int> wins{0};
+        void on_fight(const std::shared_ptr<NPC>, const std::shared_ptr<NPC>, bool win) override {
+            if (win) ++wins;
+        }
+    };
+    auto counter = std::make_shared<WinCounter>();
+    auto duck = std::make_shared<Duck>("Duck", 5, 5);
+    std::vector<std::shared_ptr<NPC>> bears;
+    for (int t = 0; t < 8; ++t) {
+        bears.push_back(std::make_shared<Bear>("Bear" + std::to_string(t), 5, 5));
+        bears.back()->subscribe(counter);
+    }
+
+    std::vector<std::thread> threads;
+    for (auto& bear : bears) {
+        threads.emplace_back([bear, duck]() {
+            while (duck->isAlive()) bear->fight(duck);
+        });
+    }
+    std::atomic<bool> moving{true};
+    auto walker = std::make_shared<Bear>("Walker", 50, 50);
+    threads.emplace_back([&]() {
+        for (int k = 0; k < 20000; ++k) walker->moveRandomly(100, 100);
+        moving = false;
+    });
+    while (moving) {
+        auto [px, py] = walker->position();
+        ASSERT_TRUE(px >= 0 && px < 100 && py >= 0 && py < 100);
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_FALSE(duck->isAlive());
+    EXPECT_EQ(counter->wins.load(), 1);
+    EXPECT_FALSE(duck->kill());
+    EXPECT_FALSE(duck->tryClaim());
+    for (auto& bear : bears) EXPECT_TRUE(bear->tryClaim());
+}
+
+TEST(WorldFrameTest, ReadersKeepConsistentFramesWhileTheWorldMoves) {
+    World world(200, 200, 13);
+    for (int i = 0; i < 500; ++i) {
+        CounterRng rng(13, static_cast<uint64_t>(i), 0, RngStream::Spawn);
+        world.add(static_cast<NpcType>(rng.uniform(0, 2)), "n" + std::to_string(i), rng.uniform(0, 199), rng.uniform(0, 199));
+    }
+    world.trackOccupancy(20);
+    FrameBuffer frames;
+    frames.publish(world);
+
+    auto pinned = frames.current();
+    const std::vector<int> pinnedX = pinned->x;
+    EXPECT_EQ(pinned->tick, 0u);
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> checked{0};
+    std::thread reader([&]() {
+        uint64_t lastTick = 0;
+        size_t lastAlive = world.size();
+        while (!done) {
+            auto frame = frames.current();
+            ASSERT_GE(frame->tick, lastTick);
+            uint32_t occupied = 0;
+            for (int r = 0; r < frame->occupancy->getRows(); ++r) {
+                for (int c = 0; c < frame->occupancy->getCols(); ++c) occupied += frame->occupancy->total(c, r);
+            }
+            // The frozen grid and the columns come from the same instant.
+            ASSERT_EQ(occupied, frame->aliveCount());
+            ASSERT_LE(frame->aliveCount(), lastAlive);
+            lastTick = frame->tick;
+            lastAlive = frame->aliveCount();
+            ++checked;
+        }
+    });
+
+    ThreadPool pool(2);
+    SpatialGrid grid;
+    for (int tick = 0; tick < 200; ++tick) {
+        world.beginTick();
+        pool.parallelFor(0, world.size(), 64, [&](size_t b, size_t e) { world.moveRange(b, e); });
+        for (const auto& [a, d] : grid.findContacts(world)) world.fight(a, d);
+        frames.publish(world);
+    }
+    done = true;
+    reader.join();
+
+    EXPECT_GT(checked.load(), 0u);
+    EXPECT_EQ(pinned->x, pinnedX);
+    EXPECT_EQ(frames.current()->tick, 200u);
+    EXPECT_EQ(frames.current()->aliveCount(), world.aliveCount());
+    EXPECT_EQ(frames.getPublished(), 201u);
+    EXPECT_LT(frames.getAllocations(), frames.getPublished());
+}
+
+TEST(TileTest, ContactsMatchSingleGridAcrossMigrations) {
+    std::mt19937 gen(17);
+    std::uniform_int_distribution<> coord(0, 299);
+    std::uniform_int_distribution<> type(0, 2);
+
+    World world(300, 300);
+    for (int i = 0; i < 2000; ++i) {
+        world.add(static_cast<NpcType>(type(gen)), "npc" + std::to_string(i), coord(gen), coord(gen));
+    }
+
+    ThreadPool pool(4);
+    SpatialGrid grid;
+    TileDecomposition tiles(world.getMapSizeX(), world.getMapSizeY(), 25);
+    tiles.assign(world);
+    EXPECT_EQ(tiles.tileCount(), 144u);
+
+    for (int tick = 0; tick < 20; ++tick) {
+        world.beginTick();
+        tiles.move(world, pool);
+        tiles.migrate(world, pool);
+
+        size_t owned = 0;
+        for (size_t t = 0; t < tiles.tileCount(); ++t) {
+            for (size_t i : tiles.owned(t)) {
+                ASSERT_EQ(tiles.tileOf(world.getX(i), world.getY(i)), t);
+                ++owned;
+            }
+        }
+        ASSERT_EQ(owned, world.aliveCount());
+
+        auto contacts = tiles.findContacts(world, pool);
+        ASSERT_EQ(contacts, grid.findContacts(world));
+        for (const auto& [a, d] : contacts) world.fight(a, d);
+    }
+    EXPECT_GT(tiles.getMigrations(), 0u);
+    EXPECT_LT(world.aliveCount(), world.size());
+}
+
+TEST(TileTest, DuckOnlyTilesSleepWithoutLosingFights) {
+    std::mt19937 gen(23);
+    std::uniform_int_distribution<> coord(0, 149);
+    std::uniform_int_distribution<> type(0, 2);
+
+    // Left half is all Ducks; the right half is mixed.
+    World world(300, 150);
+    for (int i = 0; i < 1500; ++i) {
+        const int x = coord(gen);
+        world.add(NpcType::Duck, "duck" + std::to_string(i), x, coord(gen));
+        world.add(static_cast<NpcType>(type(gen)), "npc" + std::to_string(i), 150 + x, coord(gen));
+    }
+
+    ThreadPool pool(4);
+    SpatialGrid grid;
+    TileDecomposition tiles(world.getMapSizeX(), world.getMapSizeY(), 25);
+    tiles.setSleeping(true);
+    tiles.assign(world);
+
+    for (int tick = 0; tick < 5; ++tick) {
+        world.beginTick();
+        tiles.move(world, pool);
+        tiles.migrate(world, pool);
+
+        std::vector<SpatialGrid::Contact> fightable;
+        for (const auto& [a, d] : grid.findContacts(world)) {
+            if (canAttack(world.getTypeId(a), world.getTypeId(d))) fightable.emplace_back(a, d);
+        }
+        ASSERT_EQ(tiles.findContacts(world, pool), fightable);
+        EXPECT_GT(tiles.getActiveTiles(), 0u);
+        EXPECT_LT(tiles.getActiveTiles(), tiles.tileCount());
+    }
+    EXPECT_GT(tiles.getActiveFraction(), 0.0);
+    EXPECT_LT(tiles.getActiveFraction(), 1.0);
+}
+
+TEST(TimingWheelTest, EventsFireOnTheirTickAcrossLevels) {
+    TimingWheel wheel(5);
+    const std::vector<uint64_t> dues = {6, 7, 69, 70, 5 + 64 * 64, 9000, 300000, 5 + (uint64_t{1} << 24) + 3};
+    for (size_t k = 0; k < dues.size(); ++k) wheel.schedule(k, dues[k]);
+    wheel.schedule(99, 2); // already past: fires on the next tick
+    EXPECT_EQ(wheel.size(), dues.size() + 1);
+
+    std::vector<uint64_t> fired;
+    std::vector<std::pair<uint64_t, uint64_t>> seen;
+    while (wheel.size() > 0) {
+        fired.clear();
+        wheel.advance(fired);
+        for (uint64_t payload : fired) seen.emplace_back(payload, wheel.getNow());
+    }
+
+    ASSERT_EQ(seen.size(), dues.size() + 1);
+    EXPECT_NE(std::find(seen.begin(), seen.end(), std::make_pair(uint64_t{99}, uint64_t{6})), seen.end());
+    for (size_t k = 0; k < dues.size(); ++k) {
+        auto it = std::find_if(seen.begin(), seen.end(), [&](const auto& s) { return s.first == k; });
+        ASSERT_NE(it, seen.end());
+        EXPECT_EQ(it->second, dues[k]);
+    }
+}
+
+TEST(TimingWheelTest, EqualRatesMatchTheFixedTick) {
+    std::mt19937 gen(31);
+    std::uniform_int_distribution<> coord(0, 199);
+    std::uniform_int_distribution<> type(0, 2);
+
+    World fixed(200, 200, 77), wheeled(200, 200, 77);
+    for (int i = 0; i < 600; ++i) {
+        const NpcType t = static_cast<NpcType>(type(gen));
+        const int x = coord(gen), y = coord(gen);
+        fixed.add(t, "npc", x, y);
+        wheeled.add(t, "npc", x, y);
+    }
+
+    ThreadPool pool(2);
+    SpatialGrid grid;
+    RateScheduler rates(wheeled);
+    rates.scheduleAll();
+    for (int tick = 0; tick < 30; ++tick) {
+        fixed.moveAll();
+        rates.tick(pool);
+        EXPECT_EQ(rates.getMovesDue(), wheeled.aliveCount());
+
+        auto expected = grid.findContacts(fixed);
+        auto contacts = grid.findContacts(wheeled);
+        rates.filterContacts(contacts);
+        ASSERT_EQ(contacts, expected);
+        for (const auto& [a, d] : expected) {
+            fixed.fight(a, d);
+            wheeled.fight(a, d);
+        }
+    }
+    for (size_t i = 0; i < fixed.size(); ++i) {
+        ASSERT_EQ(wheeled.getX(i), fixed.getX(i));
+        ASSERT_EQ(wheeled.getY(i), fixed.getY(i));
+        ASSERT_EQ(wheeled.isAlive(i), fixed.isAlive(i));
+    }
+}
+
+TEST(TimingWheelTest, SpeciesMoveAndAttackOnTheirOwnCadence) {
+    World world(1000, 1000);
+    for (int i = 0; i < 40; ++i) {
+        world.add(NpcType::Duck, "duck", 500, 500);
+        world.add(NpcType::Bear, "bear", 500, 500);
+    }
+
+    ThreadPool pool(2);
+    RateScheduler rates(world);
+    rates.setRate(NpcType::Duck, {4, 2});
+    rates.setRate(NpcType::Bear, {1, 3});
+    rates.scheduleAll();
+
+    size_t moves = 0, attacks = 0;
+    for (int tick = 0; tick < 12; ++tick) {
+        rates.tick(pool);
+        moves += rates.getMovesDue();
+        attacks += rates.getAttacksDue();
+    }
+    // Over 12 ticks: ducks move 3 times and attack 6, bears move 12 and attack 4.
+    EXPECT_EQ(moves, 40u * 3 + 40u * 12);
+    EXPECT_EQ(attacks, 40u * 6 + 40u * 4);
+}
+
+TEST(EventBusTest, SubscribersGetFilteredPerTickBatchesOnTheirOwnThread) {
+    EventBus bus;
+    std::mutex mtx;
+    std::vector<WorldEvent> fights;
+    std::vector<uint64_t> fightTicks;
+    std::set<std::thread::id> handlerThreads;
+    size_t spawns = 0;
+
+    bus.subscribe(eventBit(EventType::Fight) | eventBit(EventType::Kill), [&](uint64_t tick, const std::vector<WorldEvent>& events) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& e : events) {
+            EXPECT_TRUE(e.type == EventType::Fight || e.type == EventType::Kill);
+            EXPECT_EQ(e.tick, tick);
+            fights.push_back(e);
+        }
+        fightTicks.push_back(tick);
+        handlerThreads.insert(std::this_thread::get_id());
+    });
+    bus.subscribe(eventBit(EventType::Spawn), [&](uint64_t, const std::vector<WorldEvent>& events) {
+        std::lock_guard<std::mutex> lock(mtx);
+        spawns += events.size();
+        handlerThreads.insert(std::this_thread::get_id());
+    });
+    EXPECT_FALSE(bus.wants(EventType::Move));
+
+    World world(60, 60);
+    world.setEventBus(&bus);
+    for (int i = 0; i < 200; ++i) {
+        world.add(static_cast<NpcType>(i % 3), "npc" + std::to_string(i), (i * 7) % 60, (i * 13) % 60);
+    }
+    bus.flush(world.getTick());
+
+    SpatialGrid grid;
+    size_t wins = 0, total = 0;
+    for (int tick = 0; tick < 10; ++tick) {
+        world.moveAll();
+        for (const auto& [a, d] : grid.findContacts(world)) {
+            const FightResult result = world.fight(a, d);
+            total += result != FightResult::NoFight;
+            wins += result == FightResult::Won;
+        }
+        bus.flush(world.getTick());
+    }
+    bus.drain();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    EXPECT_EQ(spawns, 200u);
+    EXPECT_GT(total, 0u);
+    EXPECT_EQ(fights.size(), total + wins);
+    EXPECT_EQ(std::count_if(fights.begin(), fights.end(), [](const WorldEvent& e) { return e.type == EventType::Kill; }),
+              static_cast<long>(wins));
+    EXPECT_TRUE(std::is_sorted(fightTicks.begin(), fightTicks.end()));
+    EXPECT_EQ(handlerThreads.size(), 2u);
+    EXPECT_EQ(handlerThreads.count(std::this_thread::get_id()), 0u);
+    EXPECT_EQ(bus.getPublished(), 200u + total + wins);
+}
+
+TEST(EventBusTest, FightObserverAdapterFeedsLegacyObservers) {
+    auto observer = std::make_shared<TestObserver>();
+    EventBus bus;
+    bus.subscribe(FightObserverAdapter::kFilter, FightObserverAdapter(observer));
+
+    World world(100, 100);
+    world.setEventBus(&bus);
+    size_t bear = world.add(NpcType::Bear, "Grizzly", 10, 10);
+    size_t duck = world.add(NpcType::Duck, "Donald", 12, 10);
+    FightResult result = FightResult::Lost;
+    for (uint64_t tick = 1; result == FightResult::Lost; ++tick) {
+        world.setTick(tick);
+        result = world.fight(bear, duck);
+    }
+    bus.flush(world.getTick());
+    bus.stop();
+
+    EXPECT_GE(observer->calls, 1);
+    EXPECT_TRUE(observer->lastWin);
+    EXPECT_EQ(observer->lastAttacker->getName(), "Grizzly");
+    EXPECT_EQ(observer->lastDefender->getName(), "Donald");
+    EXPECT_EQ(observer->lastDefender->getX(), 12);
+    EXPECT_FALSE(observer->lastDefender->isAlive());
+}
+
+TEST(ReplayTest, ReplayReproducesTheRecordedSurvivors) {
+    const std::string path = "replay_test.bin";
+    std::mt19937 gen(41);
+    std::uniform_int_distribution<> coord(0, 99);
+    std::uniform_int_distribution<> type(0, 2);
+
+    World world(100, 100, 1234);
+    for (int i = 0; i < 400; ++i) {
+        world.add(static_cast<NpcType>(type(gen)), "npc" + std::to_string(i), coord(gen), coord(gen));
+    }
+
+    ThreadPool pool(4);
+    SpatialGrid grid;
+    BattleQueue queue(1024);
+    BattleWorkers workers(world, queue, 4);
+    ContactCoalescer coalescer(queue, Backpressure::Coalesce);
+    ReplayRecorder recorder;
+    recorder.open(path, world);
+    workers.setRecorder(&recorder);
+
+    for (int tick = 0; tick < 40; ++tick) {
+        world.beginTick();
+        pool.parallelFor(0, world.size(), 64, [&](size_t b, size_t e) { world.moveRange(b, e); });
+        coalescer.submit(world, grid.findContacts(world, pool));
+        workers.drain(pool);
+        recorder.endTick(world.getTick());
+    }
+    recorder.close();
+    EXPECT_GT(workers.getKills(), 0u);
+    EXPECT_GE(recorder.getSteps(), workers.getFights());
+
+    World replayed(1, 1);
+    const ReplayStats stats = replaySession(replayed, path, pool);
+    EXPECT_EQ(stats.ticks, 40u);
+    EXPECT_EQ(stats.fights, workers.getFights());
+    EXPECT_EQ(stats.mismatches, 0u);
+    EXPECT_EQ(replayed.getSeed(), 1234u);
+    ASSERT_EQ(replayed.size(), world.size());
+    for (size_t i = 0; i < world.size(); ++i) {
+        EXPECT_EQ(replayed.isAlive(i), world.isAlive(i));
+        EXPECT_EQ(replayed.getX(i), world.getX(i));
+        EXPECT_EQ(replayed.getY(i), world.getY(i));
+    }
+
+    std::remove(path.c_str());
+    std::remove((path + ".snap").c_str());
+}
+
+TEST(CheckpointTest, BasePlusDeltasRebuildTheWorld) {
+    const std::string path = "checkpoint_test.bin";
+    std::mt19937 gen(59);
+    std::uniform_int_distribution<> coord(0, 99);
+    std::uniform_int_distribution<> type(0, 2);
+
+    World world(100, 100, 99);
+    for (int i = 0; i < 500; ++i) {
+        world.add(static_cast<NpcType>(type(gen)), "npc" + std::to_string(i), coord(gen), coord(gen));
+    }
+
+    SpatialGrid grid;
+    FrameBuffer frames;
+    Checkpointer checkpointer;
+    checkpointer.open(path, world);
+    for (int tick = 1; tick <= 30; ++tick) {
+        // Only the first 100 NPCs move, so deltas stay small.
+        world.beginTick();
+        world.moveRange(0, 100);
+        for (const auto& [a, d] : grid.findContacts(world)) world.fight(a, d);
+        if (tick % 5 == 0) {
+            frames.publish(world);
+            checkpointer.submit(frames.current());
+        }
+    }
+    checkpointer.close();
+
+    EXPECT_GT(checkpointer.getWritten(), 0u);
+    EXPECT_EQ(checkpointer.getWritten() + checkpointer.getSkipped(), 6u);
+    EXPECT_LT(checkpointer.getEntries(), checkpointer.getWritten() * world.size());
+
+    World rebuilt(1, 1);
+    EXPECT_EQ(loadCheckpoint(rebuilt, path), 30u);
+    ASSERT_EQ(rebuilt.size(), world.size());
+    EXPECT_EQ(rebuilt.getSeed(), 99u);
+    for (size_t i = 0; i < world.size(); ++i) {
+        EXPECT_EQ(rebuilt.isAlive(i), world.isAlive(i));
+        EXPECT_EQ(rebuilt.getX(i), world.getX(i));
+        EXPECT_EQ(rebuilt.getY(i), world.getY(i));
+        EXPECT_EQ(rebuilt.getName(i), world.getName(i));
+    }
+
+    // A torn header claiming more entries than the log holds is ignored too.
+    const auto logSize = std::filesystem::file_size(path + ".delta");
+    std::FILE* log = std::fopen((path + ".delta").c_str(), "ab");
+    DeltaHeader torn{31, uint64_t(1) << 60, 0};
+    std::fwrite(&torn, sizeof(torn), 1, log);
+    std::fclose(log);
+    EXPECT_EQ(loadCheckpoint(rebuilt, path), 30u);
+    std::filesystem::resize_file(path + ".delta", logSize);
+
+    // A delta cut short is ignored; the rebuild stops at the one before.
+    log = std::fopen((path + ".delta").c_str(), "ab");
+    DeltaHeader partial{31, 5, 0};
+    std::fwrite(&partial, sizeof(partial), 1, log);
+    std::fclose(log);
+    EXPECT_EQ(loadCheckpoint(rebuilt, path), 30u);
+
+    // A slot recycled after open() is not written as a delta under the old
+    // NPC's name: the writer asks for a new base instead.
+    checkpointer.open(path, world);
+    const uint64_t writtenBefore = checkpointer.getWritten();
+    size_t dead = 0;
+    while (world.isAlive(dead)) ++dead;
+    world.kill(dead);
+    ASSERT_EQ(world.add(NpcType::Duck, "newcomer", 1, 2), dead);
+    world.beginTick();
+    frames.publish(world);
+    checkpointer.submit(frames.current());
+    checkpointer.flush();
+    EXPECT_TRUE(checkpointer.needsBase());
+    EXPECT_EQ(checkpointer.getWritten(), writtenBefore);
+    checkpointer.rebase(world);
+    EXPECT_FALSE(checkpointer.needsBase());
+    world.beginTick();
+    world.moveRange(0, 100);
+    frames.publish(world);
+    checkpointer.submit(frames.current());
+    checkpointer.close();
+    EXPECT_EQ(checkpointer.getWritten(), writtenBefore + 1);
+    EXPECT_FALSE(checkpointer.hasFailed());
+    EXPECT_EQ(loadCheckpoint(rebuilt, path), world.getTick());
+    EXPECT_EQ(rebuilt.getName(dead), "newcomer");
+    EXPECT_EQ(rebuilt.getX(dead), world.getX(dead));
+
+    std::remove(path.c_str());
+    std::remove((path + ".delta").c_str());
+
+    // A log that cannot be written is reported, not silently truncated.
+    if (std::filesystem::exists("/dev/full")) {
+        std::filesystem::create_symlink("/dev/full", path + ".delta");
+        EXPECT_THROW(checkpointer.open(path, world), std::runtime_error);
+        EXPECT_FALSE(checkpointer.isOpen());
+        std::remove(path.c_str());
+        std::remove((path + ".delta").c_str());
+    }
+}
+
+TEST(ConsoleReporterTest, OneSummaryPerTickWithOptionalKillLines) {
+    World world(100, 100);
+    world.add(NpcType::Bear, "Bear0", 0, 0);
+    world.add(NpcType::Duck, "Duck1", 0, 0);
+    world.add(NpcType::Duck, "Duck2", 0, 0);
+    world.add(NpcType::Desman, "Desman3", 0, 0);
+
+    std::ostringstream os;
+    std::mutex mtx;
+    ConsoleReporter reporter(world, os, mtx);
+    reporter.setTopN(1);
+
+    auto kill = [](uint32_t a, NpcType at, const char* an, uint32_t d, NpcType dt, const char* dn) {
+        WorldEvent e;
+        e.type = EventType::Kill;
+        e.npc = a;
+        e.npcType = at;
+        e.npcName = an;
+        e.other = d;
+        e.otherType = dt;
+        e.otherName = dn;
+        return e;
+    };
+    WorldEvent spawn;
+    spawn.type = EventType::Spawn;
+    spawn.npcType = NpcType::Duck;
+
+    reporter.report(7, {kill(0, NpcType::Bear, "Bear0", 1, NpcType::Duck, "Duck1"), spawn,
+                        kill(0, NpcType::Bear, "Bear0", 2, NpcType::Duck, "Duck2")});
+    EXPECT_EQ(os.str(), "[tick 7] 2 kills: Bear>Duck 2 | alive: Bear 1, Duck 1, Desman 1\n"
+                        "  top: Bear0 2\n");
+
+    os.str("");
+    reporter.setVerbose(true);
+    reporter.setTopN(0);
+    reporter.report(8, {kill(3, NpcType::Desman, "Desman3", 0, NpcType::Bear, "Bear0")});
+    EXPECT_EQ(os.str(), "[BATTLE] Desman3 killed Bear0\n"
+                        "[tick 8] 1 kill: Desman>Bear 1 | alive: Bear 0, Duck 1, Desman 1\n");
+
+    os.str("");
+    reporter.report(9, {spawn});
+    EXPECT_EQ(os.str(), "");
+    EXPECT_EQ(reporter.getAlive(NpcType::Duck), 2u);
+}
+
+TEST(ScenarioTest, ParallelSpawnIsDeterministicAndFollowsTheSpec) {
+    ThreadPool pool(4);
+    ThreadPool single(1);
+
+    // Uniform with equal ratios draws exactly what one add() per NPC did.
+    ScenarioSpec spec;
+    spec.count = 200000;
+    spec.seed = 42;
+    World world(500, 400);
+    generateScenario(world, spec, pool);
+    ASSERT_EQ(world.size(), spec.count);
+    EXPECT_EQ(world.getMapSizeX(), 500);
+    for (size_t i = 0; i < world.size(); i += 997) {
+        CounterRng rng(42, i, 0, RngStream::Spawn);
+        const int x = rng.uniform(0, 499);
+        const int y = rng.uniform(0, 399);
+        const NpcType type = static_cast<NpcType>(rng.uniform(0, static_cast<int>(kSpeciesCount) - 1));
+        ASSERT_EQ(world.getX(i), x);
+        ASSERT_EQ(world.getY(i), y);
+        ASSERT_EQ(world.getTypeId(i), type);
+        ASSERT_EQ(world.getName(i), typeName(type) + std::to_string(i));
+    }
+
+    // Ratios, and the pool size does not change the result.
+    spec.ratios = {0, 3, 1};
+    spec.distribution = Distribution::Clustered;
+    spec.clusters = 4;
+    spec.clusterRadius = 10;
+    World clustered(500, 400);
+    generateScenario(clustered, spec, pool);
+    World again(500, 400);
+    generateScenario(again, spec, single);
+    std::array<size_t, kSpeciesCount> perType{};
+    for (size_t i = 0; i < clustered.size(); ++i) {
+        ASSERT_EQ(clustered.getX(i), again.getX(i));
+        ASSERT_EQ(clustered.getName(i), again.getName(i));
+        ++perType[static_cast<size_t>(clustered.getTypeId(i))];
+    }
+    EXPECT_EQ(perType[0], 0u);
+    EXPECT_NEAR(static_cast<double>(perType[1]) / spec.count, 0.75, 0.01);
+    EXPECT_NEAR(static_cast<double>(perType[2]) / spec.count, 0.25, 0.01);
+    // Four clusters of at most 21x21 cover a small part of the map.
+    std::vector<uint8_t> used(500 * 400, 0);
+    for (size_t i = 0; i < clustered.size(); ++i) used[clustered.getY(i) * 500 + clustered.getX(i)] = 1;
+    EXPECT_LE(std::count(used.begin(), used.end(), 1), 4 * 21 * 21);
+
+    // Density: a 2x1 image whose left half is black puts everyone on the right.
+    const std::string path = "scenario_density_test.pgm";
+    {
+        std::ofstream os(path, std::ios::binary);
+        os << "P5\n# left empty\n2 1\n255\n";
+        os.put(0);
+        os.put(static_cast<char>(200));
+    }
+    auto density = std::make_shared<DensityMap>(loadDensityMap(path));
+    std::remove(path.c_str());
+    EXPECT_EQ(density->width, 2);
+    spec.distribution = Distribution::Density;
+    spec.density = density;
+    World dense(500, 400);
+    generateScenario(dense, spec, pool);
+    for (size_t i = 0; i < dense.size(); ++i) {
+        ASSERT_GE(dense.getX(i), 250);
+        ASSERT_LT(dense.getX(i), 500);
+    }
+
+    spec.ratios = {0, 0, 0};
+    EXPECT_THROW(generateScenario(dense, spec, pool), std::invalid_argument);
+
+    // Large ratios work up to an int-sized total and are rejected past it.
+    spec.distribution = Distribution::Uniform;
+    spec.count = 1000;
+    spec.ratios = {static_cast<uint32_t>(std::numeric_limits<int>::max()) - 1, 1, 0};
+    generateScenario(dense, spec, pool);
+    EXPECT_EQ(dense.size(), 1000u);
+    spec.ratios = {std::numeric_limits<uint32_t>::max(), 1, 1};
+    EXPECT_THROW(generateScenario(dense, spec, pool), std::invalid_argument);
+}
+
+TEST(NameTableTest, ParallelAssignMatchesSerialInterning) {
+    std::vector<std::string> storage;
+    for (int i = 0; i < 100000; ++i) {
+        storage.push_back(i % 7 == 0 ? "dup" + std::to_string(i % 1000) : "npc" + std::to_string(i));
+    }
+    storage.push_back("");
+    storage.push_back("");
+    std::vector<std::string_view> names(storage.begin(), storage.end());
+
+    NameTable serial;
+    std::vector<uint32_t> serialIds;
+    for (std::string_view name : names) serialIds.push_back(serial.intern(name));
+
+    ThreadPool pool(4);
+    NameTable parallel;
+    parallel.intern("stale");
+    std::vector<uint32_t> ids(names.size());
+    parallel.assign(names.data(), names.size(), ids.data(), pool);
+
+    EXPECT_EQ(ids, serialIds);
+    ASSERT_EQ(parallel.size(), serial.size());
+    EXPECT_EQ(parallel.bytes(), serial.bytes());
+    for (size_t id = 0; id < parallel.size(); ++id) ASSERT_EQ(parallel.get(id), serial.get(id));
+    // The index works for later interning, old and new names alike.
+    EXPECT_EQ(parallel.intern("dup500"), serial.intern("dup500"));
+    EXPECT_EQ(parallel.intern("npc99999"), serialIds[99999]);
+    EXPECT_EQ(parallel.intern("fresh"), serial.size());
+    EXPECT_EQ(parallel.get(parallel.size() - 1), "fresh");
+}
@@ -0,0 +1,40 @@
+#include "../include/fight_log.hpp"
+#include <fstream>
+#include <iostream>
+
+// Turns a binary fight log back into the text format of log.txt.
+// Usage: fight_log_decode <fight_log.bin> [log.txt]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <fight_log.bin> [log.txt]" << std::endl;
+        return 1;
+    }
+
+    FightLogReader reader;
+    if (!reader.open(argv[1])) {
+        std::cerr << "Cannot read fight log: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 2) {
+        file.open(argv[2], std::ios::app);
+        if (!file) {
+            std::cerr << "Cannot open output: " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& os = argc > 2 ? static_cast<std::ostream&>(file) : std::cout;
+
+    // Fights involving NPCs spawned into recycled or new slots after the log
+    // was opened cannot be named, so they are skipped and counted.
+    FightRecord record;
+    uint64_t unknown = 0;
+    while (reader.next(record)) {
+        if (!writeTextRecord(os, record, reader)) ++unknown;
+    }
+    if (unknown > 0) {
+        std::cerr << "Skipped " << unknown << " fights involving NPCs spawned after the log was opened" << std::endl;
+    }
+    return 0;
+}